@@ -0,0 +1,29 @@
+#!/bin/bash
+
+# Times a multi-word expander binary on a synthetic design, as
+# generated by synth-flo.bash.  The defaults produce roughly a million
+# narrow operations on a 32-bit target.
+#   expand.bash <flo-mwe binary> [operation count] [max width]
+
+set -e
+
+if [[ "$1" == "" ]]
+then
+    echo "$0 <flo-mwe binary> [operation count] [max width]" >&2
+    exit 1
+fi
+
+binary="$(readlink -f "$1")"
+ops="${2:-100000}"
+max_width="${3:-256}"
+
+tempdir=`mktemp -d -t bench-flo-mwe.XXXXXXXXXX`
+trap "rm -rf $tempdir" EXIT
+
+"$(dirname "$0")"/synth-flo.bash "$ops" "$max_width" > $tempdir/wide.flo
+echo "$(wc -l < $tempdir/wide.flo) wide operations"
+
+time "$binary" --width 32 --depth 1024 \
+    --input $tempdir/wide.flo --output $tempdir/narrow.flo
+
+echo "$(wc -l < $tempdir/narrow.flo) narrow operations"
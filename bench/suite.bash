@@ -0,0 +1,79 @@
+#!/bin/bash
+
+# Runs a multi-word expander binary over a fixed set of synthetic
+# designs (see synth-flo.bash) and collects every run's --profile
+# output into one JSON document on stdout, so results can be compared
+# between versions.  Progress goes to stderr.  The operation counts
+# are all multiplied by <scale>, which defaults to 1.
+#   suite.bash <flo-mwe binary> [scale] [extra flo-mwe arguments]
+
+set -e
+
+if [[ "$1" == "" ]]
+then
+    echo "$0 <flo-mwe binary> [scale] [extra flo-mwe arguments]" >&2
+    exit 1
+fi
+
+binary="$(readlink -f "$1")"
+scale="${2:-1}"
+shift
+shift || true
+extra="$@"
+
+bench="$(dirname "$0")"
+
+tempdir=`mktemp -d -t bench-flo-mwe.XXXXXXXXXX`
+trap "rm -rf $tempdir" EXIT
+
+echo "{"
+echo "  \"binary\": \"$binary\","
+echo "  \"scale\": $scale,"
+echo "  \"designs\": ["
+
+# Generates and expands a single design.
+#   run <name> <operation count> <max width> <synth-flo.bash arguments> \
+#       <flo-mwe arguments>
+first=true
+run() {
+    name="$1"
+    ops=$(($2 * scale))
+
+    echo "$name: $ops operations" >&2
+    "$bench"/synth-flo.bash $4 $ops $3 > $tempdir/wide.flo
+
+    "$binary" --width 32 --depth 1024 $5 $extra \
+        --input $tempdir/wide.flo --output $tempdir/narrow.flo \
+        --profile $tempdir/profile.json
+
+    $first || echo "    ,"
+    first=false
+
+    echo "    {"
+    echo "      \"name\": \"$name\","
+    echo "      \"arguments\": \"$5\","
+    echo "      \"wide_ops\": $(wc -l < $tempdir/wide.flo),"
+    echo "      \"narrow_ops\": $(wc -l < $tempdir/narrow.flo),"
+    echo "      \"profile\":"
+    sed 's/^/      /' $tempdir/profile.json
+    echo "    }"
+}
+
+arith="--min-width 64 --mix add=4,sub=2,neg=1,lt=1,eq=1"
+logic="--mix and=1,or=1,xor=1,not=1,mux=1,cat=1"
+shift="--mix lsh=1,rsh=1,cat=1"
+mul="--min-width 64 --mix mul=1,add=1"
+mem="--mems 16 --mem-depth 16384 --mix rd=2,wr=1,add=1"
+
+run mixed      100000  256 ""               ""
+run mixed-wide   2000 4096 "--min-width 64" ""
+run arith        2000 4096 "$arith"         ""
+run arith-la     2000 4096 "$arith"         "--adder lookahead"
+run logic       20000 1024 "$logic"         ""
+run shift       20000 1024 "$shift"         ""
+run mul           100 1024 "$mul"           ""
+run mem          5000  256 "$mem"           ""
+run stream     100000  256 ""               "--stream"
+
+echo "  ]"
+echo "}"
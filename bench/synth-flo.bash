@@ -0,0 +1,154 @@
+#!/bin/bash
+
+# Generates a synthetic wide Flo file, which is useful for measuring
+# how long the multi-word expander takes on large designs without
+# needing to go through Chisel.
+#   synth-flo.bash [options] <operation count> <max width> [seed]
+#
+# The options are
+#   --mix <kind>=<weight>,...  picks operations in proportion to the
+#                              given weights, the default is an even
+#                              mix of add, sub, and, or, xor, not, mux,
+#                              eq, lt, lsh, rsh, cat and reg (mul, neg,
+#                              rd and wr can be added too)
+#   --min-width <w>            doesn't generate operations narrower than
+#                              <w> bits (the default mixes in 8 and 32)
+#   --mems <n>                 declares <n> memories for rd and wr to use
+#   --mem-depth <d>            sets the depth of those memories (1024)
+
+usage() {
+    echo "$0 [--mix <kind>=<weight>,...] [--min-width <w>] [--mems <n>] [--mem-depth <d>] <operation count> <max width> [seed]" >&2
+    exit 1
+}
+
+mix="add=1,sub=1,and=1,or=1,xor=1,not=1,mux=1,eq=1,lt=1,lsh=1,rsh=1,cat=1,reg=1"
+min_width=1
+mems=0
+mem_depth=1024
+
+while [[ "$1" == --* ]]
+do
+    [[ "$2" == "" ]] && usage
+    case "$1" in
+    --mix)       mix="$2";;
+    --min-width) min_width="$2";;
+    --mems)      mems="$2";;
+    --mem-depth) mem_depth="$2";;
+    *)           usage;;
+    esac
+    shift 2
+done
+
+if [[ ! "$1" =~ ^[0-9]+$ || ! "$2" =~ ^[0-9]+$ ]]
+then
+    usage
+fi
+
+awk -v ops="$1" -v max_width="$2" -v seed="${3:-0}" \
+    -v mix="$mix" -v min_width="$min_width" \
+    -v mems="$mems" -v mem_depth="$mem_depth" '
+function pick(w) {
+    if (count[w] == 0 || rand() < 0.05) {
+        name = sprintf("io_i%d", inputs++)
+        printf("%s = in\047%d\n", name, w)
+        pool[w, count[w] % 16] = name
+        count[w]++
+        return name
+    }
+    n = count[w] < 16 ? count[w] : 16
+    return pool[w, int(rand() * n)]
+}
+
+function define(name, w) {
+    pool[w, count[w] % 16] = name
+    count[w]++
+}
+
+BEGIN {
+    srand(seed)
+
+    # Most nodes in real designs are narrow, with a few wide
+    # datapaths mixed in.
+    nwidths = 0
+    if (min_width <= 8)  widths[nwidths++] = 8
+    if (min_width <= 32) widths[nwidths++] = 32
+    for (w = 64; w <= max_width; w *= 2)
+        if (w >= min_width)
+            widths[nwidths++] = w
+    if (nwidths == 0) {
+        print "No widths between " min_width " and " max_width > "/dev/stderr"
+        exit 1
+    }
+
+    nkinds = split(mix, entries, ",")
+    total = 0
+    for (i = 1; i <= nkinds; i++) {
+        split(entries[i], pair, "=")
+        kinds[i] = pair[1]
+        total += pair[2]
+        cumulative[i] = total
+    }
+
+    # Every memory gets one of the usual widths, the address is
+    # however wide it needs to be to cover the whole depth.
+    for (addr_width = 1; 2 ^ addr_width < mem_depth; addr_width++)
+        ;
+    for (m = 0; m < mems; m++) {
+        mem_width[m] = widths[int(rand() * nwidths)]
+        printf("M%d = mem\047%d %d\n", m, mem_width[m], mem_depth)
+    }
+
+    for (i = 0; i < ops; i++) {
+        w = widths[int(rand() * nwidths)]
+        r = rand() * total
+        for (j = 1; j < nkinds && cumulative[j] <= r; j++)
+            ;
+        k = kinds[j]
+        d = sprintf("T%d", i)
+
+        if ((k == "rd" || k == "wr") && mems == 0) {
+            print "rd and wr need --mems" > "/dev/stderr"
+            exit 1
+        }
+
+        if (k == "not" || k == "neg") {
+            printf("%s = %s\047%d %s\n", d, k, w, pick(w))
+            define(d, w)
+        } else if (k == "mux") {
+            printf("%s = mux\047%d %s %s %s\n", d, w, pick(1), pick(w), pick(w))
+            define(d, w)
+        } else if (k == "eq" || k == "lt") {
+            printf("%s = %s\047%d %s %s\n", d, k, w, pick(w), pick(w))
+            define(d, 1)
+        } else if (k == "lsh" || k == "rsh") {
+            printf("%s = %s\047%d %s %d\n", d, k, w, pick(w), int(rand() * w))
+            define(d, w)
+        } else if (k == "cat") {
+            h = w / 2
+            if (h < 1) h = 1
+            printf("%s = cat\047%d %s %s\n", d, 2 * h, pick(h), pick(h))
+            define(d, 2 * h)
+        } else if (k == "reg") {
+            printf("%s = reg\047%d 1 %s\n", d, w, pick(w))
+            define(d, w)
+        } else if (k == "rd") {
+            m = int(rand() * mems)
+            w = mem_width[m]
+            printf("%s = rd\047%d %s M%d %s\n",
+                   d, w, pick(1), m, pick(addr_width))
+            define(d, w)
+        } else if (k == "wr") {
+            m = int(rand() * mems)
+            w = mem_width[m]
+            printf("%s = wr\047%d %s M%d %s %s\n",
+                   d, w, pick(1), m, pick(addr_width), pick(w))
+            continue
+        } else {
+            printf("%s = %s\047%d %s %s\n", d, k, w, pick(w), pick(w))
+            define(d, w)
+        }
+
+        if (rand() < 0.01)
+            printf("io_o%d = out\047%d %s\n", i, w, d)
+    }
+}'
@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2014 Palmer Dabbelt
+ *   <palmer.dabbelt@eecs.berkeley.edu>
+ *
+ * This file is part of flo-mwe.
+ *
+ * flo-mwe is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * flo-mwe is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with flo-mwe.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "adder.h++"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef std::vector<std::shared_ptr<libflo::operation<narrow_node>>> out_t;
+typedef std::shared_ptr<narrow_node> node_ptr;
+
+/* Finds the carry into every word from the generate and propagate
+ * bits of the words below it.  Entry "i" of the result is the carry
+ * into word "i + 1", NULL means there's never a carry. */
+static std::vector<node_ptr> lookahead(out_t& out,
+                                       std::vector<node_ptr> g,
+                                       std::vector<node_ptr> p);
+static std::vector<node_ptr> select(out_t& out,
+                                    const std::vector<node_ptr>& g,
+                                    const std::vector<node_ptr>& p);
+
+/* Produces a single-bit temporary from a bitwise operation on
+ * single-bit nodes. */
+static node_ptr bit(out_t& out,
+                    libflo::opcode opcode,
+                    const std::vector<node_ptr>& s);
+
+/* The carry out of a run of words with generate bit "g" and propagate
+ * bit "p" when "c" is carried into it. */
+static node_ptr carry(out_t& out,
+                      const node_ptr& g,
+                      const node_ptr& p,
+                      const node_ptr& c);
+
+bool adder_strategy_from_string(const std::string& s, adder_strategy& out)
+{
+    if (strcmp(s.c_str(), "ripple") == 0)
+        out = adder_strategy::RIPPLE;
+    else if (strcmp(s.c_str(), "select") == 0)
+        out = adder_strategy::SELECT;
+    else if (strcmp(s.c_str(), "lookahead") == 0)
+        out = adder_strategy::LOOKAHEAD;
+    else
+        return false;
+
+    return true;
+}
+
+void narrow_add(out_t& out,
+                const expand_context& ctx,
+                const std::shared_ptr<libflo::operation<wide_node>>& op,
+                adder_strategy adder)
+{
+    const size_t words = op->d()->nnode_count(ctx);
+    const bool add = (op->op() == libflo::opcode::ADD);
+
+    /* Every word is first added (or subtracted) on its own.  The
+     * bottom word never has anything carried into it, so that's
+     * already the result.  Every word other than the top one then
+     * produces a generate bit, which is set when the word carries out
+     * by itself, and a propagate bit, which is set when it carries
+     * out exactly when something was carried in.  For subtraction
+     * these are the borrow versions: the word borrows by itself when
+     * S < T, and passes a borrow along when S == T. */
+    std::vector<node_ptr> partial(words);
+    std::vector<node_ptr> g(words - 1);
+    std::vector<node_ptr> p(words - 1);
+    for (size_t i = 0; i < words; ++i) {
+        const auto& d = op->d()->nnode(ctx, i);
+        const auto& s = op->s()->nnode(ctx, i);
+        const auto& t = op->t()->nnode(ctx, i);
+
+        partial[i] = (i == 0) ? d : narrow_node::create_temp(d);
+        auto partial_op = libflo::operation<narrow_node>::create(
+            partial[i],
+            partial[i]->width_u(),
+            op->op(),
+            {s, t}
+            );
+        out.push_back(partial_op);
+
+        if (i + 1 == words)
+            continue;
+
+        g[i] = narrow_node::create_temp(1);
+        p[i] = narrow_node::create_temp(1);
+
+        if (add) {
+            auto ones = (d->width() >= 64)
+                ? ~(size_t)0
+                : ((size_t)1 << d->width()) - 1;
+
+            auto g_op = libflo::operation<narrow_node>::create(
+                g[i],
+                partial[i]->width_u(),
+                libflo::opcode::LT,
+                {partial[i], s}
+                );
+            out.push_back(g_op);
+
+            auto p_op = libflo::operation<narrow_node>::create(
+                p[i],
+                partial[i]->width_u(),
+                libflo::opcode::EQ,
+                {partial[i], narrow_node::create_const(partial[i], ones)}
+                );
+            out.push_back(p_op);
+        } else {
+            auto g_op = libflo::operation<narrow_node>::create(
+                g[i],
+                s->width_u(),
+                libflo::opcode::LT,
+                {s, t}
+                );
+            out.push_back(g_op);
+
+            auto p_op = libflo::operation<narrow_node>::create(
+                p[i],
+                s->width_u(),
+                libflo::opcode::EQ,
+                {s, t}
+                );
+            out.push_back(p_op);
+        }
+    }
+
+    std::vector<node_ptr> carries;
+    switch (adder) {
+    case adder_strategy::LOOKAHEAD:
+        carries = lookahead(out, g, p);
+        break;
+    case adder_strategy::SELECT:
+        carries = select(out, g, p);
+        break;
+    case adder_strategy::RIPPLE:
+        fprintf(stderr, "The ripple adder is expanded by narrow_op()\n");
+        abort();
+        break;
+    }
+
+    /* Finally each carry gets cast to a whole word and added into
+     * (or subtracted from) the word above it. */
+    for (size_t i = 1; i < words; ++i) {
+        const auto& d = op->d()->nnode(ctx, i);
+        auto c = carries[i - 1];
+
+        auto c_w = narrow_node::create_temp(d);
+        auto c_w_op = libflo::operation<narrow_node>::create(
+            c_w,
+            c_w->width_u(),
+            libflo::opcode::RSH,
+            {c, narrow_node::create_const(d, 0)}
+            );
+        out.push_back(c_w_op);
+
+        auto full_op = libflo::operation<narrow_node>::create(
+            d,
+            d->width_u(),
+            op->op(),
+            {partial[i], c_w}
+            );
+        out.push_back(full_op);
+    }
+}
+
+std::vector<node_ptr> lookahead(out_t& out,
+                                std::vector<node_ptr> g,
+                                std::vector<node_ptr> p)
+{
+    /* This is a Sklansky prefix network: at every level the upper
+     * half of each block of "2 * span" words is combined with the
+     * last word of the lower half, which has already been combined
+     * with everything below it.  After log2(words) levels every
+     * generate bit covers all the words below it, which makes it the
+     * carry out of that word.  Propagate bits are only needed by
+     * later levels. */
+    const size_t m = g.size();
+    for (size_t span = 1; span < m; span *= 2) {
+        for (size_t i = 0; i < m; ++i) {
+            if ((i & span) == 0)
+                continue;
+
+            size_t j = (i & ~(2 * span - 1)) + span - 1;
+
+            auto ng = carry(out, g[i], p[i], g[j]);
+            if (2 * span < m)
+                p[i] = bit(out, libflo::opcode::AND, {p[i], p[j]});
+            g[i] = ng;
+        }
+    }
+
+    return g;
+}
+
+std::vector<node_ptr> select(out_t& out,
+                             const std::vector<node_ptr>& g,
+                             const std::vector<node_ptr>& p)
+{
+    /* The words are split into blocks of about sqrt(words) words.
+     * Inside each block the carries ripple twice, once assuming
+     * nothing was carried into the block and once assuming something
+     * was, and the real carries are then picked with a MUX once the
+     * carry into the block is known.  This means a carry only has to
+     * ripple through one MUX per block. */
+    const size_t m = g.size();
+    size_t block = 1;
+    while (block * block < m)
+        block++;
+
+    std::vector<node_ptr> carries(m);
+    node_ptr in = NULL;
+    for (size_t first = 0; first < m; first += block) {
+        size_t last = (first + block < m) ? first + block : m;
+
+        /* Nothing is ever carried into the first block. */
+        if (first == 0) {
+            node_ptr c = NULL;
+            for (size_t i = first; i < last; ++i) {
+                c = carry(out, g[i], p[i], c);
+                carries[i] = c;
+            }
+
+            in = carries[last - 1];
+            continue;
+        }
+
+        auto c0 = g[first];
+        auto c1 = bit(out, libflo::opcode::OR, {g[first], p[first]});
+        for (size_t i = first; i < last; ++i) {
+            if (i != first) {
+                c0 = carry(out, g[i], p[i], c0);
+                c1 = carry(out, g[i], p[i], c1);
+            }
+
+            carries[i] = bit(out, libflo::opcode::MUX, {in, c1, c0});
+        }
+
+        in = carries[last - 1];
+    }
+
+    return carries;
+}
+
+node_ptr bit(out_t& out, libflo::opcode opcode, const std::vector<node_ptr>& s)
+{
+    auto r = narrow_node::create_temp(1);
+    auto r_op = libflo::operation<narrow_node>::create(
+        r,
+        r->width_u(),
+        opcode,
+        s
+        );
+    out.push_back(r_op);
+    return r;
+}
+
+node_ptr carry(out_t& out,
+               const node_ptr& g,
+               const node_ptr& p,
+               const node_ptr& c)
+{
+    if (c == NULL)
+        return g;
+
+    auto pc = bit(out, libflo::opcode::AND, {p, c});
+    return bit(out, libflo::opcode::OR, {g, pc});
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2014 Palmer Dabbelt
+ *   <palmer.dabbelt@eecs.berkeley.edu>
+ *
+ * This file is part of flo-mwe.
+ *
+ * flo-mwe is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * flo-mwe is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with flo-mwe.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADDER_HXX
+#define ADDER_HXX
+
+#include "expand_context.h++"
+#include "narrow_node.h++"
+#include "wide_node.h++"
+#include <libflo/operation.h++>
+#include <string>
+#include <vector>
+
+/* Multi-word additions and subtractions need a carry (or borrow)
+ * between each word.  A ripple carry computes each word's carry from
+ * the one before it, so its depth grows linearly with the number of
+ * words.  The other adders compute a generate and a propagate bit
+ * for every word up front and then either combine those in a
+ * log-depth prefix network (lookahead) or ripple inside small blocks
+ * whose results are picked once each block's carry is known
+ * (select). */
+enum class adder_strategy {
+    RIPPLE,
+    SELECT,
+    LOOKAHEAD,
+};
+
+/* Parses the argument to --adder, returning FALSE if it's not an
+ * adder. */
+bool adder_strategy_from_string(const std::string& s, adder_strategy& out);
+
+/* Expands a multi-word ADD or SUB with either the select or the
+ * lookahead adder, the ripple adder lives in narrow_op(). */
+void narrow_add(std::vector<std::shared_ptr<libflo::operation<narrow_node>>>& out,
+                const expand_context& ctx,
+                const std::shared_ptr<libflo::operation<wide_node>>& op,
+                adder_strategy adder);
+
+#endif
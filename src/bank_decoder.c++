@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2014 Palmer Dabbelt
+ *   <palmer.dabbelt@eecs.berkeley.edu>
+ *
+ * This file is part of flo-mwe.
+ *
+ * flo-mwe is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * flo-mwe is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with flo-mwe.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "bank_decoder.h++"
+#include <cmath>
+#include <libflo/sizet_printf.h++>
+#include <string.h>
+
+#ifndef LINE_MAX
+#define LINE_MAX 1024
+#endif
+
+/* Creates one of the nodes of a decoder, which is either a named part
+ * of a shared decoder or a temporary. */
+static std::shared_ptr<shallow_node> part(const std::string& prefix,
+                                          const char *suffix,
+                                          size_t width);
+
+bool mem_split_strategy_from_string(const std::string& s,
+                                    mem_split_strategy& out)
+{
+    if (strcmp(s.c_str(), "linear") == 0)
+        out = mem_split_strategy::LINEAR;
+    else if (strcmp(s.c_str(), "tree") == 0)
+        out = mem_split_strategy::TREE;
+    else if (strcmp(s.c_str(), "auto") == 0)
+        out = mem_split_strategy::AUTO;
+    else
+        return false;
+
+    return true;
+}
+
+bool mem_split_use_tree(mem_split_strategy strategy, size_t banks)
+{
+    switch (strategy) {
+    case mem_split_strategy::LINEAR:
+        return false;
+    case mem_split_strategy::TREE:
+        return true;
+    case mem_split_strategy::AUTO:
+        return banks > 2;
+    }
+
+    return false;
+}
+
+bank_decoder::bank_decoder(const std::shared_ptr<shallow_node>& addr,
+                           size_t mem_depth,
+                           size_t bank_depth)
+    : _addr(addr),
+      _banks(bank_count(mem_depth, bank_depth)),
+      _shift_count(std::log2(bank_depth)),
+      _lo(),
+      _hi(),
+      _matches(),
+      _selects()
+{
+    /* Constant addresses don't get shared, so their decoders are
+     * built from temporaries.  Everything else gets named after the
+     * address. */
+    std::string prefix = "";
+    if (addr->is_const() == false)
+        prefix = name(addr->name(), _banks);
+
+    _lo = part(prefix, "lo", _shift_count);
+    _hi = part(prefix, "hi", addr->width() - _shift_count);
+
+    _matches.reserve(_banks);
+    for (size_t i = 0; i < _banks; ++i) {
+        char suffix[LINE_MAX];
+        snprintf(suffix, LINE_MAX, "b" SIZET_FORMAT, i);
+        _matches.push_back(part(prefix, suffix, 1));
+    }
+
+    for (size_t i = 0; ((size_t)1 << i) < _banks; ++i) {
+        char suffix[LINE_MAX];
+        snprintf(suffix, LINE_MAX, "s" SIZET_FORMAT, i);
+        _selects.push_back(part(prefix, suffix, 1));
+    }
+}
+
+void bank_decoder::emit(out_t& out, const decoder_parts& parts) const
+{
+    if (parts.split) {
+        auto lo_op = libflo::operation<shallow_node>::create(
+            _lo,
+            _shift_count,
+            libflo::opcode::RSH,
+            {_addr, shallow_node::create_const(_addr, 0)}
+            );
+        out.push_back(lo_op);
+
+        auto hi_op = libflo::operation<shallow_node>::create(
+            _hi,
+            _addr->width() - _shift_count,
+            libflo::opcode::RSH,
+            {_addr, shallow_node::create_const(_addr, _shift_count)}
+            );
+        out.push_back(hi_op);
+    }
+
+    /* Every bank gets a comparator, which is a single operation no
+     * matter how many banks there are. */
+    if (parts.matches) {
+        for (size_t i = 0; i < _banks; ++i) {
+            auto match_op = libflo::operation<shallow_node>::create(
+                _matches[i],
+                _hi->width_u(),
+                libflo::opcode::EQ,
+                {_hi, shallow_node::create_const(_hi, i)}
+                );
+            out.push_back(match_op);
+        }
+    }
+
+    /* The MUX tree just uses the bits of the bank number. */
+    if (parts.selects) {
+        for (size_t i = 0; i < _selects.size(); ++i) {
+            auto select_op = libflo::operation<shallow_node>::create(
+                _selects[i],
+                1,
+                libflo::opcode::RSH,
+                {_hi, shallow_node::create_const(_hi, i)}
+                );
+            out.push_back(select_op);
+        }
+    }
+}
+
+std::string bank_decoder::name(const std::string& addr, size_t banks)
+{
+    char name[LINE_MAX];
+    snprintf(name, LINE_MAX, "MWEd%s_" SIZET_FORMAT, addr.c_str(), banks);
+    return name;
+}
+
+size_t bank_decoder::bank_count(size_t mem_depth, size_t bank_depth)
+{
+    return (mem_depth + bank_depth - 1) / bank_depth;
+}
+
+bank_decoder_plan::bank_decoder_plan(size_t depth,
+                                     mem_split_strategy strategy)
+    : _depth(depth),
+      _strategy(strategy),
+      _owners(),
+      _parts()
+{
+}
+
+void bank_decoder_plan::add_port(size_t index,
+                                 libflo::opcode op,
+                                 size_t mem_depth,
+                                 const std::string& addr,
+                                 bool addr_is_const)
+{
+    /* Memories that fit don't get split, so they don't need a
+     * decoder at all. */
+    if (mem_depth <= _depth || addr_is_const)
+        return;
+
+    size_t banks = bank_decoder::bank_count(mem_depth, _depth);
+
+    auto owner = _owners.find(bank_decoder::name(addr, banks));
+    if (owner == _owners.end()) {
+        _owners[bank_decoder::name(addr, banks)] = index;
+        _parts[index] = {true, false, false};
+        owner = _owners.find(bank_decoder::name(addr, banks));
+    }
+
+    auto& parts = _parts[owner->second];
+    if (op == libflo::opcode::RD && mem_split_use_tree(_strategy, banks))
+        parts.selects = true;
+    else
+        parts.matches = true;
+}
+
+decoder_parts bank_decoder_plan::parts(size_t index) const
+{
+    auto found = _parts.find(index);
+    if (found == _parts.end())
+        return {false, false, false};
+
+    return found->second;
+}
+
+std::shared_ptr<shallow_node> part(const std::string& prefix,
+                                   const char *suffix,
+                                   size_t width)
+{
+    if (prefix == "")
+        return shallow_node::create_temp(width);
+
+    return std::make_shared<shallow_node>(prefix + "_" + suffix,
+                                          width,
+                                          0,
+                                          false,
+                                          false,
+                                          libflo::unknown<size_t>(),
+                                          libflo::unknown<std::string>());
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2014 Palmer Dabbelt
+ *   <palmer.dabbelt@eecs.berkeley.edu>
+ *
+ * This file is part of flo-mwe.
+ *
+ * flo-mwe is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * flo-mwe is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with flo-mwe.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BANK_DECODER_HXX
+#define BANK_DECODER_HXX
+
+#include "shallow_node.h++"
+#include <libflo/opcode.h++>
+#include <libflo/operation.h++>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Memories that are deeper than the target allows are split into
+ * banks, and a read port has to pick its result from one of those
+ * banks.  That can either be done with a chain of MUXes (one per
+ * bank, each checking for its own bank number) or with a balanced
+ * tree of MUXes that's driven by the bank-number bits directly.  The
+ * chain is never shorter, but it's no longer for two banks and it's
+ * what was always generated before. */
+enum class mem_split_strategy {
+    LINEAR,
+    TREE,
+    AUTO,               /* A tree for more than two banks */
+};
+
+/* Parses the argument to --mem-split-strategy, returning FALSE if
+ * it's not a strategy. */
+bool mem_split_strategy_from_string(const std::string& s,
+                                    mem_split_strategy& out);
+
+/* Returns TRUE if reads from a memory that's been split into "banks"
+ * banks should use a MUX tree. */
+bool mem_split_use_tree(mem_split_strategy strategy, size_t banks);
+
+/* The parts of a bank decoder that an operation has to generate. */
+struct decoder_parts {
+    bool split;         /* The in-bank and bank-number addresses */
+    bool matches;       /* One bank-number comparison per bank */
+    bool selects;       /* One bank-number bit per MUX tree level */
+};
+
+/* Decodes an address into a memory that's been split into banks:
+ * the low bits address a location within a bank, and the high bits
+ * pick the bank.  Every port on every split memory that uses the same
+ * address node shares a single decoder, whose nodes are named after
+ * the address.  Ports that use a constant address get their own
+ * decoder that's made out of temporaries. */
+class bank_decoder {
+    typedef std::vector<std::shared_ptr<libflo::operation<shallow_node>>>
+    out_t;
+
+private:
+    std::shared_ptr<shallow_node> _addr;
+    size_t _banks;
+    size_t _shift_count;
+    std::shared_ptr<shallow_node> _lo;
+    std::shared_ptr<shallow_node> _hi;
+    std::vector<std::shared_ptr<shallow_node>> _matches;
+    std::vector<std::shared_ptr<shallow_node>> _selects;
+
+public:
+    /* Creates the decoder for an address into a memory with
+     * "mem_depth" entries, split into banks with "bank_depth"
+     * entries. */
+    bank_decoder(const std::shared_ptr<shallow_node>& addr,
+                 size_t mem_depth,
+                 size_t bank_depth);
+
+public:
+    size_t banks(void) const { return _banks; }
+    size_t levels(void) const { return _selects.size(); }
+
+    /* The address within a bank and the bank number. */
+    const std::shared_ptr<shallow_node>& lo(void) const { return _lo; }
+    const std::shared_ptr<shallow_node>& hi(void) const { return _hi; }
+
+    /* Set when the bank number is "bank". */
+    const std::shared_ptr<shallow_node>& match(size_t bank) const
+        { return _matches[bank]; }
+
+    /* Bit "level" of the bank number. */
+    const std::shared_ptr<shallow_node>& select(size_t level) const
+        { return _selects[level]; }
+
+    /* Appends the operations that compute the given parts of this
+     * decoder. */
+    void emit(out_t& out, const decoder_parts& parts) const;
+
+    /* Returns the name of the decoder that's shared by every port
+     * that uses "addr" on a memory with "banks" banks, which is also
+     * the prefix of every node in it. */
+    static std::string name(const std::string& addr, size_t banks);
+
+    /* Returns the number of banks with "bank_depth" entries that a
+     * memory with "mem_depth" entries is split into. */
+    static size_t bank_count(size_t mem_depth, size_t bank_depth);
+};
+
+/* Decides which operation generates each shared bank decoder, which
+ * has to be done before anything is expanded because operations are
+ * expanded independently of each other.  The first port (in input
+ * order) that uses a decoder generates every part of it that any port
+ * needs, the other ports just refer to it by name. */
+class bank_decoder_plan {
+private:
+    const size_t _depth;
+    const mem_split_strategy _strategy;
+
+    /* Maps the name of each shared decoder to the index of the
+     * operation that generates it, and each of those operations to
+     * the parts of the decoder it generates. */
+    std::unordered_map<std::string, size_t> _owners;
+    std::unordered_map<size_t, decoder_parts> _parts;
+
+public:
+    bank_decoder_plan(size_t depth, mem_split_strategy strategy);
+
+public:
+    mem_split_strategy strategy(void) const { return _strategy; }
+
+    /* Records that operation "index" is a RD or WR port on a memory
+     * with "mem_depth" entries, addressed by the node "addr".  Ports
+     * have to be added in input order. */
+    void add_port(size_t index,
+                  libflo::opcode op,
+                  size_t mem_depth,
+                  const std::string& addr,
+                  bool addr_is_const);
+
+    /* Returns the parts of a shared decoder that operation "index"
+     * generates, which is nothing for most operations. */
+    decoder_parts parts(size_t index) const;
+};
+
+#endif
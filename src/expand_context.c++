@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2014 Palmer Dabbelt
+ *   <palmer.dabbelt@eecs.berkeley.edu>
+ *
+ * This file is part of flo-mwe.
+ *
+ * flo-mwe is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * flo-mwe is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with flo-mwe.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "expand_context.h++"
+#include <atomic>
+
+static std::atomic<size_t> next_id(0);
+
+expand_context::expand_context(size_t word_length, size_t mem_depth)
+    : _id(next_id++),
+      _word_length(word_length),
+      _mem_depth(mem_depth)
+{
+}
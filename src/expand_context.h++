@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2014 Palmer Dabbelt
+ *   <palmer.dabbelt@eecs.berkeley.edu>
+ *
+ * This file is part of flo-mwe.
+ *
+ * flo-mwe is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * flo-mwe is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with flo-mwe.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXPAND_CONTEXT_HXX
+#define EXPAND_CONTEXT_HXX
+
+#include <stddef.h>
+
+/* Describes the machine that a design is being expanded for: how
+ * many bits fit in one of its words and how deep its memories can
+ * be.  Nodes are mapped to narrow and shallow nodes separately for
+ * every context, which means a design that's been parsed once can be
+ * expanded for any number of machines at the same time. */
+class expand_context {
+private:
+    /* Distinguishes between contexts, no two contexts that are
+     * constructed ever have the same ID. */
+    const size_t _id;
+
+    const size_t _word_length;
+    const size_t _mem_depth;
+
+public:
+    expand_context(size_t word_length, size_t mem_depth);
+
+public:
+    size_t id(void) const { return _id; }
+    size_t word_length(void) const { return _word_length; }
+    size_t mem_depth(void) const { return _mem_depth; }
+};
+
+#endif
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2014 Palmer Dabbelt
+ *   <palmer.dabbelt@eecs.berkeley.edu>
+ *
+ * This file is part of flo-mwe.
+ *
+ * flo-mwe is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * flo-mwe is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with flo-mwe.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "expand_op.h++"
+#include "narrow_op.h++"
+#include "split_mem.h++"
+#include "temp_namespace.h++"
+
+typedef std::vector<std::shared_ptr<libflo::operation<shallow_node>>> out_t;
+
+out_t expand_op(const std::shared_ptr<libflo::operation<wide_node>>& op,
+                size_t index, const expand_context& ctx,
+                const bank_decoder_plan& decoders,
+                adder_strategy adder, size_t karatsuba,
+                profile *prof)
+{
+    temp_namespace ns(index);
+
+    /* A memory that's wider than a word has one port per word, but
+     * they all share an address so only the first one generates the
+     * decoder. */
+    auto parts = decoders.parts(index);
+
+    uint64_t start = (prof != NULL) ? profile::now() : 0;
+    auto nops = narrow_op(op, ctx, adder, karatsuba);
+    uint64_t narrowed = (prof != NULL) ? profile::now() : 0;
+
+    out_t out;
+    for (const auto& nop: nops) {
+        auto sops = split_mem(nop, ctx, decoders.strategy(), parts);
+        for (const auto& sop: sops)
+            out.push_back(sop);
+
+        if (nop->op() == libflo::opcode::RD ||
+            nop->op() == libflo::opcode::WR)
+            parts = {false, false, false};
+    }
+
+    if (prof != NULL) {
+        uint64_t split = profile::now();
+        prof->add_time(profile_phase::NARROW, op->op(), narrowed - start);
+        prof->add_time(profile_phase::SPLIT_MEM, op->op(), split - narrowed);
+        prof->add_expansion(op->op(), out.size());
+        prof->add_temps(ns);
+    }
+
+    return out;
+}
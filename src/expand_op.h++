@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2014 Palmer Dabbelt
+ *   <palmer.dabbelt@eecs.berkeley.edu>
+ *
+ * This file is part of flo-mwe.
+ *
+ * flo-mwe is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * flo-mwe is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with flo-mwe.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXPAND_OP_HXX
+#define EXPAND_OP_HXX
+
+#include "adder.h++"
+#include "bank_decoder.h++"
+#include "expand_context.h++"
+#include "profile.h++"
+#include "shallow_node.h++"
+#include "wide_node.h++"
+#include <libflo/operation.h++>
+#include <vector>
+
+/* Expands a single wide operation all the way down to shallow
+ * operations for the machine described by "ctx" (narrow_op() followed
+ * by split_mem()).  "index" is the position of this operation in the
+ * input, which names the namespace that every temporary created
+ * during the expansion lives in and decides which bank decoders it
+ * generates.  The expansion is recorded in "prof" unless that's
+ * NULL. */
+std::vector<std::shared_ptr<libflo::operation<shallow_node>>>
+expand_op(const std::shared_ptr<libflo::operation<wide_node>>& op,
+          size_t index, const expand_context& ctx,
+          const bank_decoder_plan& decoders,
+          adder_strategy adder, size_t karatsuba,
+          profile *prof);
+
+#endif
@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) 2014 Palmer Dabbelt
+ *   <palmer.dabbelt@eecs.berkeley.edu>
+ *
+ * This file is part of flo-mwe.
+ *
+ * flo-mwe is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * flo-mwe is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with flo-mwe.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "flo_reader.h++"
+#include <libflo/sizet_printf.h++>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* One line of a Flo file, split into its parts: "d = op'width s...".
+ * The width is optional. */
+struct flo_line {
+    std::string d;
+    libflo::opcode op;
+    libflo::unknown<size_t> width;
+    std::vector<std::string> s;
+};
+
+/* Reads the next non-empty line from a Flo file, returning FALSE at
+ * the end of the file. */
+static bool read_line(FILE *file, const std::string& filename,
+                      size_t& line_number, flo_line& out);
+
+/* Returns TRUE when a token names a constant rather than a node. */
+static bool is_const_token(const std::string& token);
+
+/* Strips the (optional) width off of a constant token. */
+static std::string const_name(const std::string& token);
+
+flo_reader::flo_reader(const std::string filename)
+    : _filename(filename),
+      _file(NULL),
+      _line(0),
+      _widths(),
+      _mem_nodes(),
+      _mems(),
+      _ports()
+{
+    _file = fopen(filename.c_str(), "r");
+    if (_file == NULL) {
+        perror("fopen() failed");
+        fprintf(stderr, "Unable to open '%s' for reading\n",
+                filename.c_str());
+        abort();
+    }
+
+    /* Memories are listed in the order they first show up, either
+     * declared or used by a port, which is the order libflo lists
+     * them in. */
+    struct mem_decl {
+        libflo::unknown<size_t> width;
+        libflo::unknown<size_t> depth;
+    };
+    std::unordered_map<std::string, mem_decl> mem_decls;
+    std::vector<std::string> mem_names;
+    auto saw_mem = [&](const std::string& name) -> void
+        {
+            if (mem_decls.find(name) != mem_decls.end())
+                return;
+
+            mem_decls[name] = mem_decl();
+            mem_names.push_back(name);
+        };
+
+    /* The only place a node's width is written down is on the
+     * operation that defines it, so that's all this pass looks at.
+     * Operations are numbered the same way they are when the whole
+     * design is expanded at once, so the decoder plan matches. */
+    flo_line l;
+    size_t index = 0;
+    while (read_line(_file, _filename, _line, l) == true) {
+        switch (l.op) {
+        case libflo::opcode::MEM:
+            if (l.s.size() != 1) {
+                fprintf(stderr, "%s:" SIZET_FORMAT ": Unable to parse line\n",
+                        _filename.c_str(), _line);
+                abort();
+            }
+
+            saw_mem(l.d);
+            mem_decls[l.d] = {l.width,
+                              (size_t)strtoull(l.s[0].c_str(), NULL, 0)};
+            continue;
+
+        case libflo::opcode::EQ:
+        case libflo::opcode::NEQ:
+        case libflo::opcode::LT:
+        case libflo::opcode::GTE:
+            _widths[l.d] = (size_t)1;
+            break;
+
+        case libflo::opcode::RD:
+        case libflo::opcode::WR:
+            if (l.s.size() < 3) {
+                fprintf(stderr, "%s:" SIZET_FORMAT ": Unable to parse line\n",
+                        _filename.c_str(), _line);
+                abort();
+            }
+
+            saw_mem(l.s[1]);
+            _ports.push_back({index,
+                              l.op,
+                              l.s[1],
+                              l.s[2],
+                              is_const_token(l.s[2])});
+            _widths[l.d] = l.width;
+            break;
+
+        default:
+            _widths[l.d] = l.width;
+            break;
+        }
+
+        index++;
+    }
+
+    for (const auto& name: mem_names) {
+        const auto& decl = mem_decls[name];
+        if (decl.depth.known() == false) {
+            fprintf(stderr, "%s: Memory '%s' is never declared\n",
+                    _filename.c_str(), name.c_str());
+            abort();
+        }
+
+        auto node = std::make_shared<wide_node>(
+            name,
+            decl.width,
+            decl.depth,
+            true,
+            false,
+            libflo::unknown<size_t>(),
+            libflo::unknown<std::string>()
+            );
+        _mem_nodes[name] = node;
+        _mems.push_back(node);
+    }
+
+    rewind(_file);
+    _line = 0;
+}
+
+flo_reader::~flo_reader(void)
+{
+    fclose(_file);
+}
+
+void flo_reader::plan_decoders(bank_decoder_plan& plan) const
+{
+    for (const auto& port: _ports) {
+        plan.add_port(port.index,
+                      port.op,
+                      _mem_nodes.find(port.mem)->second->depth(),
+                      port.addr,
+                      port.addr_is_const);
+    }
+}
+
+flo_reader::op_ptr flo_reader::next(void)
+{
+    flo_line l;
+
+    do {
+        if (read_line(_file, _filename, _line, l) == false)
+            return NULL;
+    } while (l.op == libflo::opcode::MEM);
+
+    /* Every node other than a memory is built again for each
+     * operation that uses it, which keeps the amount of memory used
+     * from depending on the size of the design. */
+    auto lookup = [&](const std::string& token)
+        -> std::shared_ptr<wide_node>
+        {
+            auto mem = _mem_nodes.find(token);
+            if (mem != _mem_nodes.end())
+                return mem->second;
+
+            /* Only memories have a depth, libflo gives every other
+             * node (including constants) a depth of 0. */
+            if (is_const_token(token)) {
+                /* A constant is as wide as the operation it's used
+                 * by, unless it has its own width. */
+                libflo::unknown<size_t> width;
+                auto tick = token.find('\'');
+                if (tick != std::string::npos)
+                    width = (size_t)strtoull(token.c_str() + tick + 1,
+                                             NULL, 0);
+                else
+                    width = l.width;
+
+                if (width.known() == false) {
+                    fprintf(stderr,
+                            "%s:" SIZET_FORMAT ": No width for '%s'\n",
+                            _filename.c_str(), _line, token.c_str());
+                    abort();
+                }
+
+                return std::make_shared<wide_node>(
+                    const_name(token),
+                    width,
+                    (size_t)0,
+                    false,
+                    true,
+                    libflo::unknown<size_t>(),
+                    libflo::unknown<std::string>()
+                    );
+            }
+
+            auto found = _widths.find(token);
+            if (found == _widths.end()) {
+                fprintf(stderr, "%s:" SIZET_FORMAT ": Undefined node '%s'\n",
+                        _filename.c_str(), _line, token.c_str());
+                abort();
+            }
+
+            return std::make_shared<wide_node>(
+                token,
+                found->second,
+                (size_t)0,
+                false,
+                false,
+                libflo::unknown<size_t>(),
+                libflo::unknown<std::string>()
+                );
+        };
+
+    auto d = lookup(l.d);
+
+    std::vector<std::shared_ptr<wide_node>> s;
+    s.reserve(l.s.size());
+    for (const auto& token: l.s)
+        s.push_back(lookup(token));
+
+    return libflo::operation<wide_node>::create(d, l.width, l.op, s);
+}
+
+bool read_line(FILE *file, const std::string& filename,
+               size_t& line_number, flo_line& out)
+{
+    char *buffer = NULL;
+    size_t buffer_size = 0;
+
+    while (getline(&buffer, &buffer_size, file) > 0) {
+        line_number++;
+
+        std::vector<char *> tokens;
+        char *save;
+        for (char *t = strtok_r(buffer, " \t\r\n", &save);
+             t != NULL;
+             t = strtok_r(NULL, " \t\r\n", &save)) {
+            tokens.push_back(t);
+        }
+
+        if (tokens.size() == 0)
+            continue;
+
+        if (tokens.size() < 3 || strcmp(tokens[1], "=") != 0) {
+            fprintf(stderr, "%s:" SIZET_FORMAT ": Unable to parse line\n",
+                    filename.c_str(), line_number);
+            abort();
+        }
+
+        out.d = tokens[0];
+        out.width = libflo::unknown<size_t>();
+        out.s.clear();
+
+        char *tick = strchr(tokens[2], '\'');
+        if (tick != NULL) {
+            *tick = '\0';
+            out.width = (size_t)strtoull(tick + 1, NULL, 0);
+        }
+
+        out.op = libflo::opcode_from_string(tokens[2]);
+
+        for (size_t i = 3; i < tokens.size(); ++i)
+            out.s.push_back(tokens[i]);
+
+        free(buffer);
+        return true;
+    }
+
+    free(buffer);
+    return false;
+}
+
+bool is_const_token(const std::string& token)
+{
+    return isdigit(token[0]);
+}
+
+std::string const_name(const std::string& token)
+{
+    return token.substr(0, token.find('\''));
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2014 Palmer Dabbelt
+ *   <palmer.dabbelt@eecs.berkeley.edu>
+ *
+ * This file is part of flo-mwe.
+ *
+ * flo-mwe is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * flo-mwe is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with flo-mwe.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLO_READER_HXX
+#define FLO_READER_HXX
+
+#include "bank_decoder.h++"
+#include "wide_node.h++"
+#include <libflo/operation.h++>
+#include <stdio.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Reads a Flo file one operation at a time, as opposed to
+ * libflo::flo::parse() which holds the entire graph in memory.  A
+ * node can be used before the operation that defines it, so the file
+ * is skimmed once up front for the width of every node (which is
+ * given by the operation that defines it), its memories and their
+ * ports.  Nothing is kept for constants: each use of one gets its
+ * width from the text of the operation it's in, when that operation
+ * is read.  Operations are built as they're read and can be dropped
+ * as soon as they've been expanded. */
+class flo_reader {
+public:
+    typedef std::shared_ptr<libflo::operation<wide_node>> op_ptr;
+
+private:
+    const std::string _filename;
+    FILE *_file;
+    size_t _line;
+
+    /* The width of every named node in the file that isn't a
+     * memory. */
+    std::unordered_map<std::string, libflo::unknown<size_t>> _widths;
+
+    /* The memories, in the order they first appear in the file.
+     * These are the only wide nodes that are shared between
+     * operations. */
+    std::unordered_map<std::string, std::shared_ptr<wide_node>> _mem_nodes;
+    std::vector<std::shared_ptr<wide_node>> _mems;
+
+    /* Every RD and WR operation, by its index in the file. */
+    struct port {
+        size_t index;
+        libflo::opcode op;
+        std::string mem;
+        std::string addr;
+        bool addr_is_const;
+    };
+    std::vector<port> _ports;
+
+public:
+    /* Skims the whole file for node widths, leaving the reader
+     * positioned at the first operation. */
+    flo_reader(const std::string filename);
+    ~flo_reader(void);
+
+public:
+    /* Returns every memory that was declared in the file. */
+    const std::vector<std::shared_ptr<wide_node>>& mems(void) const
+        { return _mems; }
+
+    /* Adds every memory port in the file to a decoder plan. */
+    void plan_decoders(bank_decoder_plan& plan) const;
+
+    /* Returns the next operation in the file, or NULL once the whole
+     * file has been read. */
+    op_ptr next(void);
+};
+
+#endif
@@ -19,18 +19,114 @@
  * <http://www.gnu.org/licenses/>.
  */
 
-#include "narrow_op.h++"
+#include "adder.h++"
+#include "bank_decoder.h++"
+#include "expand_context.h++"
+#include "expand_op.h++"
+#include "flo_reader.h++"
 #include "narrow_node.h++"
-#include "split_mem.h++"
+#include "optimize.h++"
+#include "parallel_for.h++"
+#include "profile.h++"
+#include "stream_expand.h++"
 #include "version.h"
 #include "wide_node.h++"
 #include <libflo/flo.h++>
 #include <libflo/sizet_printf.h++>
 #include <libflo/version.h++>
+#include <algorithm>
+#include <functional>
 #include <stdlib.h>
 #include <string>
+#include <thread>
+#include <vector>
 using namespace libflo;
 
+#ifndef LINE_MAX
+#define LINE_MAX 1024
+#endif
+
+/* One of the machines that the design is being expanded for, along
+ * with where its output and profile go.  Targets are only profiled
+ * when asked, as reading the clock around every operation isn't
+ * free. */
+struct target {
+    expand_context ctx;
+    std::string output;
+    optimize_stats stats;
+    std::string profile_output;
+    std::shared_ptr<profile> prof;
+
+    target(size_t width, size_t depth, const std::string& output,
+           const std::string& profile_output)
+        : ctx(width, depth), output(output), stats(),
+          profile_output(profile_output),
+          prof((profile_output != "")
+               ? std::make_shared<profile>(width, depth)
+               : NULL)
+        {}
+};
+
+/* Parses the argument to --target, returning FALSE if it's not of the
+ * form "<width>:<depth>". */
+static bool parse_target(const char *value, size_t& width, size_t& depth);
+
+/* Returns the output filename for a target, which is "pattern" with
+ * every "%w" replaced by the target's width and every "%d" by its
+ * depth. */
+static std::string output_name(const std::string& pattern,
+                               size_t width, size_t depth);
+
+/* Opens the output file, bailing out if that's not possible. */
+static FILE *open_output(const std::string filename);
+
+/* Writes a profile out to the given file as JSON. */
+static void write_profile(const profile& prof, const std::string filename);
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "%s: --width <w> --depth <d> --input <i> --output <o> "
+            "[--target <w>:<d>] [--jobs <n>] [--stream] "
+            "[--mem-split-strategy <s>] "
+            "[--adder <a>] [--karatsuba <n>] [--no-optimize] [--stats] "
+            "[--profile <p>]\n",
+            argv0);
+    fprintf(stderr, "  Replaces multi-word operations with multiple\n");
+    fprintf(stderr, "  single-word operations in a Flo file.\n");
+    fprintf(stderr, "  \n");
+    fprintf(stderr, "  --input sets the input filename\n");
+    fprintf(stderr, "  --output sets the output length\n");
+    fprintf(stderr, "  --target expands for another machine with a <w>-bit\n");
+    fprintf(stderr, "    word and <d>-deep memories, and can be given more\n");
+    fprintf(stderr, "    than once (in place of --width and --depth too).\n");
+    fprintf(stderr, "    Every target is expanded at the same time, each\n");
+    fprintf(stderr, "    into its own output: any '%%w' or '%%d' in <o> is\n");
+    fprintf(stderr, "    replaced by that target's width or depth\n");
+    fprintf(stderr, "  --jobs sets the number of threads to expand with\n");
+    fprintf(stderr, "  --stream writes operations out as they're expanded\n");
+    fprintf(stderr, "  --mem-split-strategy selects between the banks of a\n");
+    fprintf(stderr, "    deep memory with a 'linear' chain or a 'tree' of\n");
+    fprintf(stderr, "    MUXes, 'auto' (the default) uses a tree for more\n");
+    fprintf(stderr, "    than two banks\n");
+    fprintf(stderr, "  --adder selects how multi-word additions carry\n");
+    fprintf(stderr, "    between words: 'ripple' (the default) goes one\n");
+    fprintf(stderr, "    word at a time, 'select' picks precomputed\n");
+    fprintf(stderr, "    carries per block and 'lookahead' uses a\n");
+    fprintf(stderr, "    log-depth prefix network\n");
+    fprintf(stderr, "  --karatsuba splits multiplications of operands\n");
+    fprintf(stderr, "    wider than <n> words (default 16) with Karatsuba's\n");
+    fprintf(stderr, "    algorithm instead of multiplying every word\n");
+    fprintf(stderr, "  --no-optimize skips cleaning up the expanded operations\n");
+    fprintf(stderr, "  --stats reports how many operations were cleaned up\n");
+    fprintf(stderr, "  --profile writes how long each phase took for each\n");
+    fprintf(stderr, "    opcode, how many operations and temporaries were\n");
+    fprintf(stderr, "    created and the peak memory use to <p> as JSON.\n");
+    fprintf(stderr, "    Every target gets its own profile: '%%w' and '%%d'\n");
+    fprintf(stderr, "    in <p> are replaced just like in <o>\n");
+    exit(1);
+}
+
 int main(int argc, const char **argv)
 {
     /* Prints the version if it was asked for. */
@@ -42,110 +138,431 @@ int main(int argc, const char **argv)
         exit(0);
     }
 
-    /* Prints the help text if anything went wrong. */
-    if (argc != 9) {
-        fprintf(stderr,
-                "%s: --width <w> --depth <d> --input <i> --output <o>\n",
-                argv[0]);
-        fprintf(stderr, "  Replaces multi-word operations with multiple\n");
-        fprintf(stderr, "  single-word operations in a Flo file.\n");
-        fprintf(stderr, "  \n");
-        fprintf(stderr, "  --input sets the input filename\n");
-        fprintf(stderr, "  --output sets the output length\n");
-        exit(1);
-    }
+    /* Parses the command-line arguments, every one of which (other
+     * than --stream, --no-optimize and --stats) takes a value. */
+    size_t arg_width = 0;
+    size_t arg_depth = 0;
+    std::vector<std::pair<size_t, size_t>> arg_targets;
+    std::string arg_input = "";
+    std::string arg_output = "";
+    size_t arg_jobs = 1;
+    bool arg_stream = false;
+    bool arg_optimize = true;
+    bool arg_stats = false;
+    mem_split_strategy arg_strategy = mem_split_strategy::AUTO;
+    adder_strategy arg_adder = adder_strategy::RIPPLE;
+    size_t arg_karatsuba = 16;
+    std::string arg_profile = "";
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--stream") == 0) {
+            arg_stream = true;
+            continue;
+        }
+
+        if (strcmp(argv[i], "--no-optimize") == 0) {
+            arg_optimize = false;
+            continue;
+        }
+
+        if (strcmp(argv[i], "--stats") == 0) {
+            arg_stats = true;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Expected a value after %s\n", argv[i]);
+            usage(argv[0]);
+        }
 
-    /* Checks for the exact command-line arguments. */
-    if (strcmp(argv[1], "--width") != 0) {
-        fprintf(stderr, "Expected --width as 1st argument\n");
-        exit(1);
+        const char *value = argv[i + 1];
+        if (strcmp(argv[i], "--width") == 0)
+            arg_width = atoi(value);
+        else if (strcmp(argv[i], "--depth") == 0)
+            arg_depth = atoi(value);
+        else if (strcmp(argv[i], "--input") == 0)
+            arg_input = value;
+        else if (strcmp(argv[i], "--output") == 0)
+            arg_output = value;
+        else if (strcmp(argv[i], "--jobs") == 0)
+            arg_jobs = atoi(value);
+        else if (strcmp(argv[i], "--profile") == 0)
+            arg_profile = value;
+        else if (strcmp(argv[i], "--target") == 0) {
+            size_t width, depth;
+            if (!parse_target(value, width, depth)) {
+                fprintf(stderr, "Unknown target %s\n", value);
+                usage(argv[0]);
+            }
+            arg_targets.push_back(std::make_pair(width, depth));
+        }
+        else if (strcmp(argv[i], "--mem-split-strategy") == 0) {
+            if (!mem_split_strategy_from_string(value, arg_strategy)) {
+                fprintf(stderr, "Unknown strategy %s\n", value);
+                usage(argv[0]);
+            }
+        } else if (strcmp(argv[i], "--karatsuba") == 0) {
+            arg_karatsuba = atoi(value);
+        } else if (strcmp(argv[i], "--adder") == 0) {
+            if (!adder_strategy_from_string(value, arg_adder)) {
+                fprintf(stderr, "Unknown adder %s\n", value);
+                usage(argv[0]);
+            }
+        } else {
+            fprintf(stderr, "Unknown argument %s\n", argv[i]);
+            usage(argv[0]);
+        }
+        i++;
     }
-    if (strcmp(argv[3], "--depth") != 0) {
-        fprintf(stderr, "Expected --width as 1st argument\n");
-        exit(1);
+
+    /* --width and --depth are just another way of giving a single
+     * target. */
+    if (arg_width != 0 || arg_depth != 0)
+        arg_targets.insert(arg_targets.begin(),
+                           std::make_pair(arg_width, arg_depth));
+
+    /* Prints the help text if anything went wrong. */
+    if (arg_targets.size() == 0 || arg_input == "" ||
+        arg_output == "" || arg_jobs == 0) {
+        usage(argv[0]);
     }
-    if (strcmp(argv[5], "--input") != 0) {
-        fprintf(stderr, "Expected --input as 3rd argument\n");
-        exit(1);
+
+    /* Every target gets its own expansion context, which is what
+     * keeps the narrow nodes that a wide node maps to on one machine
+     * apart from the ones it maps to on any other. */
+    std::vector<target> targets;
+    for (const auto& t: arg_targets) {
+        if (t.first == 0 || t.second == 0)
+            usage(argv[0]);
+
+        auto output = output_name(arg_output, t.first, t.second);
+        auto profile_output = output_name(arg_profile, t.first, t.second);
+        for (const auto& other: targets) {
+            if (other.output == output) {
+                fprintf(stderr, "More than one target writes to '%s'\n",
+                        output.c_str());
+                usage(argv[0]);
+            }
+
+            if (profile_output != "" &&
+                other.profile_output == profile_output) {
+                fprintf(stderr, "More than one target profiles to '%s'\n",
+                        profile_output.c_str());
+                usage(argv[0]);
+            }
+        }
+
+        targets.push_back(target(t.first, t.second, output,
+                                 profile_output));
     }
-    if (strcmp(argv[7], "--output") != 0) {
-        fprintf(stderr, "Expected --output as 5th argument\n");
-        exit(1);
+
+    /* In streaming mode neither graph is held in memory while
+     * expanding: the reader only keeps the width of each named node
+     * (and the memories) around, and each operation is written out
+     * as soon as it's been expanded.  The MEM declarations have to
+     * come first, but the reader has already found all of those while
+     * building its table of widths.  Operations are only read once,
+     * so there can only be one target. */
+    if (arg_stream == true) {
+        if (targets.size() != 1) {
+            fprintf(stderr, "--stream only supports a single target\n");
+            usage(argv[0]);
+        }
+        auto& t = targets[0];
+
+        /* Ports on memories that get split share their bank
+         * decoders, which are planned out before anything is
+         * expanded. */
+        bank_decoder_plan decoders(t.ctx.mem_depth(), arg_strategy);
+
+        uint64_t start = profile::now();
+        flo_reader reader(arg_input);
+        reader.plan_decoders(decoders);
+        if (t.prof != NULL)
+            t.prof->add_time(profile_phase::PARSE, profile::now() - start);
+
+        FILE *out_file = open_output(t.output);
+        setvbuf(out_file, NULL, _IOFBF, 1 << 20);
+
+        for (const auto& wnode: reader.mems()) {
+            for (const auto& nnode: wnode->nnodes(t.ctx)) {
+                for (const auto& node: nnode->snodes(t.ctx)) {
+                    if (node->depth() > t.ctx.mem_depth())
+                        continue;
+
+                    fprintf(out_file,
+                            "%s = mem'" SIZET_FORMAT " " SIZET_FORMAT "\n",
+                            node->name().c_str(),
+                            node->width(),
+                            node->depth()
+                        );
+                }
+            }
+        }
+
+        stream_expand(reader, out_file, t.ctx, arg_jobs,
+                      decoders, arg_adder, arg_karatsuba, arg_optimize,
+                      t.stats, t.prof.get());
+
+        fclose(out_file);
+
+        if (arg_stats == true)
+            t.stats.print(stderr);
+        if (t.prof != NULL)
+            write_profile(*t.prof, t.profile_output);
+        return 0;
     }
 
-    /* Finishes parsing the command-line arguments. */
-    const size_t arg_width = atoi(argv[2]);
-    const size_t arg_depth = atoi(argv[4]);
-    const std::string arg_input = argv[6];
-    const std::string arg_output = argv[8];
-
-    /* This is a bit of a hack: essentially wide nodes have a fixed
-     * width parameter that determines the word length of the target
-     * machine.  This allows me to generate the set of narrow words
-     * that coorespond to this wide word when the wide word is
-     * constructed, which is nice because I then don't do any more
-     * string munging and just use pointers. */
-    wide_node::set_word_length(arg_width);
-    wide_node::set_mem_depth(arg_depth);
-
-    /* Here we create two Flo files: one for input an one for output.
-     * The input file is read to produce the input one (which is
-     * const), and the other one accumulates outputs. */
+    /* The input Flo file is only parsed once, no matter how many
+     * targets there are, so every target's profile includes the whole
+     * parse.  libflo parses the whole file at once, so parsing can't
+     * be charged to any particular opcode. */
+    uint64_t start = profile::now();
     auto in_flo = flo<wide_node, operation<wide_node>>::parse(arg_input);
-    auto out_flo = flo<shallow_node, operation<shallow_node>>::empty();
-
-    /* Copies the set of narrow nodes into the output Flo file.  The
-     * general idea here is that we know all these will eventually end
-     * up in the output file -- there may be more internal temporary
-     * nodes, but at least we need all of these to exist. */
-    for (const auto& wnode: in_flo->nodes())
-        for (const auto& nnode: wnode->nnodes())
-            for (const auto& snode: nnode->snodes())
-                out_flo->add_node(snode);
-
-    /* Walks through each operation, converting it from an operation
-     * that consumes potientally-wide nodes to one that consumes
-     * definately-narrow nodes. */
-    for (const auto& op: in_flo->operations()) {
-        auto n = narrow_op(op, arg_width);
-        for (auto it = n.begin(); it != n.end(); ++it) {
-            auto m = split_mem(*it, arg_depth);
-            for (auto it = m.begin(); it != m.end(); ++it) {
+    uint64_t parse_ns = profile::now() - start;
+    for (auto& t: targets)
+        if (t.prof != NULL)
+            t.prof->add_time(profile_phase::PARSE, parse_ns);
+
+    const auto& wide_ops = in_flo->operations();
+    std::vector<std::shared_ptr<operation<wide_node>>> in_ops(
+        wide_ops.begin(),
+        wide_ops.end()
+        );
+
+    /* Expands the whole design for a single target, using "jobs"
+     * threads.  The input nodes are shared between every target, but
+     * each one has its own output. */
+    auto expand_target = [&](target& t, size_t jobs) -> void
+        {
+            const auto& ctx = t.ctx;
+            profile *prof = t.prof.get();
+
+            /* Here we create the output Flo file, which accumulates
+             * this target's shallow nodes and operations. */
+            auto out_flo = flo<shallow_node, operation<shallow_node>>::empty();
+
+            /* Copies the set of narrow nodes into the output Flo
+             * file.  The general idea here is that we know all these
+             * will eventually end up in the output file -- there may
+             * be more internal temporary nodes, but at least we need
+             * all of these to exist. */
+            for (const auto& wnode: in_flo->nodes())
+                for (const auto& nnode: wnode->nnodes(ctx))
+                    for (const auto& snode: nnode->snodes(ctx))
+                        out_flo->add_node(snode);
+
+            /* Ports on memories that get split share their bank
+             * decoders, which are planned out before anything is
+             * expanded. */
+            bank_decoder_plan decoders(ctx.mem_depth(), arg_strategy);
+            for (size_t i = 0; i < in_ops.size(); ++i) {
+                const auto& op = in_ops[i];
+                if (op->op() != libflo::opcode::RD &&
+                    op->op() != libflo::opcode::WR)
+                    continue;
+
+                decoders.add_port(i,
+                                  op->op(),
+                                  op->t()->depth(),
+                                  op->u()->name(),
+                                  op->u()->is_const());
+            }
+
+            /* Walks through each operation, converting it from an
+             * operation that consumes potientally-wide nodes to one
+             * that consumes definately-narrow nodes.  Every operation
+             * expands independently of every other one, so they're
+             * spread out over as many threads as were asked for.
+             * Each one gets its own namespace for temporaries and its
+             * own output list, which keeps the output identical no
+             * matter how many threads were used. */
+            std::vector<std::vector<std::shared_ptr<operation<shallow_node>>>>
+                out_ops(in_ops.size());
+
+            parallel_for(in_ops.size(), jobs,
+                         [&](size_t i) -> void
+                         {
+                             out_ops[i] = expand_op(in_ops[i], i, ctx,
+                                                    decoders, arg_adder,
+                                                    arg_karatsuba, prof);
+                         });
+
+            /* The optimizer sees the same batches of operations that
+             * it would when streaming, so the output doesn't depend
+             * on whether or not --stream was given.  Each batch is
+             * independent, so they're optimized in parallel too. */
+            size_t batch_count =
+                (in_ops.size() + OPTIMIZE_BATCH_SIZE - 1)
+                / OPTIMIZE_BATCH_SIZE;
+            std::vector<std::vector<std::shared_ptr<operation<shallow_node>>>>
+                batch_ops(batch_count);
+            std::vector<optimize_stats> batch_stats(batch_count);
+
+            parallel_for(batch_count, jobs,
+                         [&](size_t b) -> void
+                         {
+                             size_t first = b * OPTIMIZE_BATCH_SIZE;
+                             size_t last = first + OPTIMIZE_BATCH_SIZE;
+                             if (last > in_ops.size())
+                                 last = in_ops.size();
+
+                             auto& ops = batch_ops[b];
+                             for (size_t i = first; i < last; ++i) {
+                                 auto& expanded = out_ops[i];
+                                 ops.insert(ops.end(),
+                                            expanded.begin(),
+                                            expanded.end());
+                                 expanded.clear();
+                                 expanded.shrink_to_fit();
+                             }
+
+                             if (arg_optimize == true)
+                                 optimize(ops, batch_stats[b]);
+                         });
+
+            for (size_t b = 0; b < batch_count; ++b) {
+                for (const auto& op: batch_ops[b]) {
 #ifdef DEBUG_OPERATION_ADDING
-                (*it)->writeln(stderr);
+                    op->writeln(stderr);
 #endif
-                out_flo->add_op(*it);
+                    out_flo->add_op(op);
+                }
+                std::vector<std::shared_ptr<operation<shallow_node>>>()
+                    .swap(batch_ops[b]);
+
+                t.stats += batch_stats[b];
             }
-        }
+
+            /* Writes the whole output graph that was produced into a
+             * Flo file. */
+            FILE *out_file = open_output(t.output);
+
+            /* Write output, first MEM nodes and then operations. */
+            for (const auto& node: out_flo->nodes()) {
+                if (!node->is_mem())
+                    continue;
+
+                if (node->depth() > ctx.mem_depth())
+                    continue;
+
+                fprintf(out_file,
+                        "%s = mem'" SIZET_FORMAT " " SIZET_FORMAT "\n",
+                        node->name().c_str(),
+                        node->width(),
+                        node->depth()
+                    );
+            }
+
+            for (const auto& op: out_flo->operations()) {
+                if (prof == NULL) {
+                    op->writeln(out_file);
+                    continue;
+                }
+
+                uint64_t start = profile::now();
+                op->writeln(out_file);
+                prof->add_time(profile_phase::WRITE, op->op(),
+                               profile::now() - start);
+                prof->add_written(op->op());
+            }
+
+            fclose(out_file);
+
+            /* Each profile is written as soon as its target is done,
+             * so it doesn't count the time spent waiting for any
+             * other target. */
+            if (prof != NULL)
+                write_profile(*prof, t.profile_output);
+        };
+
+    /* Every target is expanded at the same time, splitting the
+     * threads that were asked for between them. */
+    if (targets.size() == 1) {
+        expand_target(targets[0], arg_jobs);
+    } else {
+        size_t jobs = std::max(arg_jobs / targets.size(), (size_t)1);
+
+        std::vector<std::thread> threads;
+        for (auto& t: targets)
+            threads.push_back(std::thread(expand_target, std::ref(t), jobs));
+        for (auto& thread: threads)
+            thread.join();
     }
 
-    /* Writes the whole output graph that was produced into a Flo
-     * file. */
-    FILE *out_file = fopen(arg_output.c_str(), "w");
-    if (out_file == NULL) {
-        perror("fopen() failed");
-        fprintf(stderr, "Unable to open '%s' for writing\n",
-                arg_output.c_str());
-        abort();
+    if (arg_stats == true) {
+        for (const auto& t: targets) {
+            if (targets.size() > 1) {
+                fprintf(stderr, "Target " SIZET_FORMAT ":" SIZET_FORMAT "\n",
+                        t.ctx.word_length(),
+                        t.ctx.mem_depth());
+            }
+
+            t.stats.print(stderr);
+        }
     }
+}
+
+bool parse_target(const char *value, size_t& width, size_t& depth)
+{
+    char *end;
 
-    /* Write output, first MEM nodes and then operations. */
-    for (const auto& node: out_flo->nodes()) {
-        if (!node->is_mem())
+    width = strtoul(value, &end, 10);
+    if (end == value || *end != ':')
+        return false;
+
+    value = end + 1;
+    depth = strtoul(value, &end, 10);
+    if (end == value || *end != '\0')
+        return false;
+
+    return true;
+}
+
+std::string output_name(const std::string& pattern,
+                        size_t width, size_t depth)
+{
+    std::string out;
+
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        if (pattern[i] != '%' || i + 1 == pattern.size()) {
+            out += pattern[i];
             continue;
+        }
 
-        if (node->depth() > wide_node::get_mem_depth())
+        char value[LINE_MAX];
+        if (pattern[i + 1] == 'w')
+            snprintf(value, LINE_MAX, SIZET_FORMAT, width);
+        else if (pattern[i + 1] == 'd')
+            snprintf(value, LINE_MAX, SIZET_FORMAT, depth);
+        else {
+            out += pattern[i];
             continue;
+        }
 
-        fprintf(out_file, "%s = mem'" SIZET_FORMAT " " SIZET_FORMAT "\n",
-                node->name().c_str(),
-                node->width(),
-                node->depth()
-            );
+        out += value;
+        i++;
     }
 
-    for (const auto& op: out_flo->operations())
-        op->writeln(out_file);
+    return out;
+}
 
-    fclose(out_file);
+FILE *open_output(const std::string filename)
+{
+    FILE *out_file = fopen(filename.c_str(), "w");
+    if (out_file == NULL) {
+        perror("fopen() failed");
+        fprintf(stderr, "Unable to open '%s' for writing\n",
+                filename.c_str());
+        abort();
+    }
+
+    return out_file;
+}
+
+void write_profile(const profile& prof, const std::string filename)
+{
+    FILE *file = open_output(filename);
+    prof.write_json(file);
+    fclose(file);
 }
@@ -20,6 +20,7 @@
  */
 
 #include "narrow_node.h++"
+#include "temp_namespace.h++"
 #include <libflo/sizet_printf.h++>
 #include <math.h>
 
@@ -27,8 +28,10 @@
 #define LINE_MAX 1024
 #endif
 
-static std::vector<std::shared_ptr<shallow_node>>
-map_shallow(const std::string name,
+static void
+map_shallow(const expand_context& ctx,
+            node_arena<shallow_node>& out,
+            const std::string name,
             const libflo::unknown<size_t>& width,
             const libflo::unknown<size_t>& depth,
             bool is_mem,
@@ -45,12 +48,8 @@ narrow_node::narrow_node(const std::string name,
                          const libflo::unknown<std::string>& posn)
     : libflo::node(name, width, depth, is_mem, is_const, cycle, posn),
       _sns(),
-      _sns_valid(false)
+      _sns_once()
 {
-    if (this->width() > wide_node::get_word_length()) {
-        fprintf(stderr, "Attempted to build a narrow node wider than a word\n");
-        abort();
-    }
 }
 
 narrow_node::narrow_node(const std::string name,
@@ -60,158 +59,114 @@ narrow_node::narrow_node(const std::string name,
                          bool is_const,
                          libflo::unknown<size_t> cycle,
                          const libflo::unknown<std::string>& posn,
-                         bool is_catd)
+                         bool /* is_catd */)
     : libflo::node(name, width, depth, is_mem, is_const, cycle, posn),
       _sns(),
-      _sns_valid(false)
+      _sns_once()
 {
-    if (!is_catd && (this->width() > wide_node::get_word_length())) {
-        fprintf(stderr, "Attempted to build a narrow node wider than a word\n");
-        abort();
-    }
 }
 
-std::vector<std::shared_ptr<shallow_node>> narrow_node::snodes(void)
+const node_arena<shallow_node>&
+narrow_node::mapped(const expand_context& ctx)
 {
-    if (_sns_valid == false) {
-        auto to_add = map_shallow(name(),
-                                  width_u(),
-                                  depth_u(),
-                                  is_mem(),
-                                  is_const(),
-                                  dfdepth_u(),
-                                  posn_u()
-            );
-
-        for (auto it = to_add.begin(); it != to_add.end(); ++it)
-            _sns.push_back(*it);
-
-        _sns_valid = true;
-    }
+    std::call_once(_sns_once, [&](void) -> void
+                   {
+                       map_shallow(ctx,
+                                   _sns,
+                                   name(),
+                                   width_u(),
+                                   depth_u(),
+                                   is_mem(),
+                                   is_const(),
+                                   dfdepth_u(),
+                                   posn_u()
+                           );
+                   });
 
     return _sns;
 }
 
-std::shared_ptr<shallow_node> narrow_node::snode(size_t i)
-{
-    if (_sns_valid == false) {
-        auto to_add = map_shallow(name(),
-                                  width_u(),
-                                  depth_u(),
-                                  is_mem(),
-                                  is_const(),
-                                  dfdepth_u(),
-                                  posn_u()
-            );
-
-        for (auto it = to_add.begin(); it != to_add.end(); ++it)
-            _sns.push_back(*it);
-
-        _sns_valid = true;
-    }
-
-    return _sns[i];
-}
-
-size_t narrow_node::snode_count(void)
-{
-    if (_sns_valid == false) {
-        auto to_add = map_shallow(name(),
-                                  width_u(),
-                                  depth_u(),
-                                  is_mem(),
-                                  is_const(),
-                                  dfdepth_u(),
-                                  posn_u()
-            );
-
-        for (auto it = to_add.begin(); it != to_add.end(); ++it)
-            _sns.push_back(*it);
-
-        _sns_valid = true;
-    }
-
-    return _sns.size();
-}
-
 std::shared_ptr<narrow_node>
 narrow_node::clone_from(std::shared_ptr<wide_node> w)
 {
-    return std::shared_ptr<narrow_node>(new narrow_node(w->name(),
-                                                        w->width_u(),
-                                                        w->depth_u(),
-                                                        w->is_mem(),
-                                                        w->is_const(),
-                                                        w->dfdepth_u(),
-                                                        w->posn_u()
-                                            ));
+    return std::make_shared<narrow_node>(w->name(),
+                                         w->width_u(),
+                                         w->depth_u(),
+                                         w->is_mem(),
+                                         w->is_const(),
+                                         w->dfdepth_u(),
+                                         w->posn_u());
 }
 
 std::shared_ptr<narrow_node>
 narrow_node::clone_from(std::shared_ptr<wide_node> w, bool force)
 {
-    return std::shared_ptr<narrow_node>(new narrow_node(w->name(),
-                                                        w->width_u(),
-                                                        w->depth_u(),
-                                                        w->is_mem(),
-                                                        w->is_const(),
-                                                        w->dfdepth_u(),
-                                                        w->posn_u(),
-                                                        force
-                                            ));
+    return std::make_shared<narrow_node>(w->name(),
+                                         w->width_u(),
+                                         w->depth_u(),
+                                         w->is_mem(),
+                                         w->is_const(),
+                                         w->dfdepth_u(),
+                                         w->posn_u(),
+                                         force);
 }
 
 std::shared_ptr<narrow_node>
 narrow_node::create_temp(const std::shared_ptr<narrow_node> t)
 {
-    static unsigned long num = 0;
-
-    char name[LINE_MAX];
-    snprintf(name, LINE_MAX, "MWEnT%lu", num++);
-
-    return std::shared_ptr<narrow_node>(new narrow_node(name,
-                                                        t->width_u(),
-                                                        t->depth_u(),
-                                                        false,
-                                                        false,
-                                                        t->dfdepth_u(),
-                                                        t->posn_u()
-                                            ));
+    auto name = temp_namespace::next(temp_family::NARROW_TEMPLATE);
+
+    return std::make_shared<narrow_node>(name,
+                                         t->width_u(),
+                                         t->depth_u(),
+                                         false,
+                                         false,
+                                         t->dfdepth_u(),
+                                         t->posn_u());
 }
 
 std::shared_ptr<narrow_node>
 narrow_node::create_temp(const size_t width)
 {
-    static unsigned long num = 0;
+    auto name = temp_namespace::next(temp_family::NARROW_WIDTH);
+
+    return std::make_shared<narrow_node>(name,
+                                         width,
+                                         0,
+                                         false,
+                                         false,
+                                         libflo::unknown<size_t>(),
+                                         libflo::unknown<std::string>());
+}
 
+std::shared_ptr<narrow_node>
+narrow_node::create_const(const std::shared_ptr<narrow_node> t, size_t value)
+{
     char name[LINE_MAX];
-    snprintf(name, LINE_MAX, "MWEnW%lu", num++);
+    snprintf(name, LINE_MAX, SIZET_FORMAT, value);
 
-    return std::shared_ptr<narrow_node>(
-        new narrow_node(name,
-                        width,
-                        0,
-                        false,
-                        false,
-                        libflo::unknown<size_t>(),
-                        libflo::unknown<std::string>()
-            ));
+    return std::make_shared<narrow_node>(name,
+                                         t->width_u(),
+                                         t->depth_u(),
+                                         t->is_mem(),
+                                         true,
+                                         t->dfdepth_u(),
+                                         t->posn_u());
 }
 
 std::shared_ptr<narrow_node>
-narrow_node::create_const(const std::shared_ptr<narrow_node> t, size_t value)
+narrow_node::create_const(size_t width, size_t value)
 {
     char name[LINE_MAX];
     snprintf(name, LINE_MAX, SIZET_FORMAT, value);
 
-    return std::shared_ptr<narrow_node>(new narrow_node(name,
-                                                        t->width_u(),
-                                                        t->depth_u(),
-                                                        t->is_mem(),
-                                                        true,
-                                                        t->dfdepth_u(),
-                                                        t->posn_u()
-                                            ));
+    return std::make_shared<narrow_node>(name,
+                                         width,
+                                         0,
+                                         false,
+                                         true,
+                                         libflo::unknown<size_t>(),
+                                         libflo::unknown<std::string>());
 }
 
 std::shared_ptr<narrow_node>
@@ -222,18 +177,19 @@ narrow_node::create_const(size_t value)
 
     size_t width = (value <= 1) ? 1 : (ceil(log2(value)) + 1);
 
-    return std::shared_ptr<narrow_node>(new narrow_node(name,
-                                                        width,
-                                                        0,
-                                                        false,
-                                                        true,
-                                                        0,
-                                                        libflo::unknown<std::string>()
-                                            ));
+    return std::make_shared<narrow_node>(name,
+                                         width,
+                                         0,
+                                         false,
+                                         true,
+                                         0,
+                                         libflo::unknown<std::string>());
 }
 
-std::vector<std::shared_ptr<shallow_node>>
-map_shallow(const std::string name,
+void
+map_shallow(const expand_context& ctx,
+            node_arena<shallow_node>& out,
+            const std::string name,
             const libflo::unknown<size_t>& width,
             const libflo::unknown<size_t>& depth,
             bool is_mem,
@@ -241,12 +197,11 @@ map_shallow(const std::string name,
             libflo::unknown<size_t> cycle,
             const libflo::unknown<std::string>& posn)
 {
-    std::vector<std::shared_ptr<shallow_node>> out;
-
     /* Here's the number of nodes we need to build from this node. */
     const size_t node_count = (depth.value() == 0) ? 1 :
-        (depth.value() + wide_node::get_mem_depth() - 1)
-        / wide_node::get_mem_depth();
+        (depth.value() + ctx.mem_depth() - 1)
+        / ctx.mem_depth();
+    out.reserve(node_count);
 
     for (size_t i = 0; i < node_count; ++i) {
         char n[LINE_MAX];
@@ -274,13 +229,10 @@ map_shallow(const std::string name,
          * many nodes that are as wide as possible. */
         libflo::unknown<size_t> d = depth;
         if (i != (node_count - 1))
-            d = wide_node::get_mem_depth();
+            d = ctx.mem_depth();
         else if (i > 0)
-            d = ((depth.value() - 1) % wide_node::get_mem_depth()) + 1;
+            d = ((depth.value() - 1) % ctx.mem_depth()) + 1;
 
-        auto p = new shallow_node(n, width, d, is_mem, is_const, cycle, posn);
-        out.push_back(std::shared_ptr<shallow_node>(p));
+        out.emplace(n, width, d, is_mem, is_const, cycle, posn);
     }
-
-    return out;
 }
@@ -24,20 +24,25 @@
 
 class narrow_node;
 
+#include "expand_context.h++"
+#include "node_arena.h++"
 #include "shallow_node.h++"
 #include "wide_node.h++"
 #include <libflo/node.h++>
+#include <mutex>
 
 /* Holds a narrow node, which is a node that will always fit within a
- * single word on the target machine. */
+ * single word on the target machine.  Every narrow node is created
+ * while expanding for a single context, and is only ever used in
+ * that context. */
 class narrow_node: public libflo::node {
     friend class libflo::node;
 
 private:
     /* Stores the set of shallow words that coorespond to this narrow
      * word. */
-    std::vector<std::shared_ptr<shallow_node>> _sns;
-    bool _sns_valid;
+    node_arena<shallow_node> _sns;
+    std::once_flag _sns_once;
 
 public:
     narrow_node(const std::string name,
@@ -58,12 +63,23 @@ public:
                 bool is_catd);
 
 public:
-    /* Returns an iterator that walks through the list of shallow nodes
-     * that would need to be created in order to implement this node
-     * on a shallow machine. */
-    std::vector<std::shared_ptr<shallow_node>> snodes(void);
-    std::shared_ptr<shallow_node> snode(size_t i);
-    size_t snode_count(void);
+    /* Returns the list of shallow nodes that would need to be created
+     * in order to implement this node on the shallow machine
+     * described by "ctx", which has to be the context this node was
+     * created in.  Just like wide nodes, these are built once and
+     * then handed out as a view into their arena. */
+    node_span<shallow_node> snodes(const expand_context& ctx)
+        { return mapped(ctx).span(); }
+
+    const std::shared_ptr<shallow_node>&
+    snode(const expand_context& ctx, size_t i)
+        { return mapped(ctx)[i]; }
+    size_t snode_count(const expand_context& ctx)
+        { return mapped(ctx).size(); }
+
+private:
+    /* Builds the shallow nodes the first time they're needed. */
+    const node_arena<shallow_node>& mapped(const expand_context& ctx);
 
 public:
     /* Clones a wide node into a narrow node. */
@@ -92,6 +108,9 @@ public:
     static std::shared_ptr<narrow_node>
     create_const(const std::shared_ptr<narrow_node> tplt, size_t value);
 
+    static std::shared_ptr<narrow_node>
+    create_const(size_t width, size_t value);
+
     /* This constant is created with the smallest width that will fit
      * it, which is useful for shift operations.  Be careful using it
      * in other places, as it can easily generate invalid widths. */
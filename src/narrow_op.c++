@@ -29,20 +29,60 @@ typedef std::vector<std::shared_ptr<libflo::operation<narrow_node>>> out_t;
  * output node, the other generates one. */
 static
 std::shared_ptr<narrow_node> bfext(out_t& out,
-                                   size_t width,
+                                   const expand_context& ctx,
                                    const std::shared_ptr<wide_node>& w,
                                    ssize_t offset,
                                    size_t count);
-static void bfext(std::shared_ptr<narrow_node>& n,
+static void bfext(const std::shared_ptr<narrow_node>& n,
                   out_t& out,
-                  size_t width,
+                  const expand_context& ctx,
                   const std::shared_ptr<wide_node>& w,
                   ssize_t offset,
                   size_t count);
 
+/* Expands a shift by a variable amount.  The high bits of the amount
+ * count whole words, so they just pick which source word ends up in
+ * each output word.  The low bits then shift within a word, which is
+ * a funnel shift between each pair of neighbouring words.  This only
+ * works when the word width is a power of two and the amount fits in
+ * a single word, it returns FALSE without emitting anything
+ * otherwise. */
+static bool shift_by_words(out_t& out,
+                           const expand_context& ctx,
+                           const std::shared_ptr<libflo::operation<wide_node>>& op);
+
+/* Expands D <= S * T, truncated to the width of D.  Operands that
+ * are more than "karatsuba" words wide are split in half and
+ * multiplied with three half-width multiplications, smaller ones
+ * are multiplied limb-by-limb. */
+static void multiply(out_t& out,
+                     const expand_context& ctx,
+                     adder_strategy adder,
+                     size_t karatsuba,
+                     const std::shared_ptr<wide_node>& d,
+                     std::shared_ptr<wide_node> s,
+                     std::shared_ptr<wide_node> t);
+
+/* The limb-by-limb multiplication that multiply() ends up at. */
+static void schoolbook(out_t& out,
+                       const expand_context& ctx,
+                       adder_strategy adder,
+                       size_t karatsuba,
+                       const std::shared_ptr<wide_node>& d,
+                       const std::shared_ptr<wide_node>& s,
+                       const std::shared_ptr<wide_node>& t);
+
+/* Returns the single narrow node that a word-sized wide node maps
+ * to. */
+static std::shared_ptr<narrow_node>
+narrow_of(const expand_context& ctx, const std::shared_ptr<wide_node>& w);
+
 out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
-                size_t width, bool emit_catd)
+                const expand_context& ctx, adder_strategy adder,
+                size_t karatsuba, bool emit_catd)
 {
+    const size_t width = ctx.word_length();
+
     /* Check to see if this operation just fits within a machine word,
      * in which case we don't really have to do anything. */
     {
@@ -52,14 +92,18 @@ out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
                 too_large = true;
 
         /* If none of the operands were too large to fit within a
-         * machine word then just do the cast. */
+         * machine word then just do the cast.  Every one of these
+         * nodes maps to exactly one narrow node, so that's used
+         * directly rather than cloning a fresh copy for every
+         * operation that happens to touch the node. */
         if (too_large == false) {
             std::shared_ptr<narrow_node> d;
             std::vector<std::shared_ptr<narrow_node>> s;
+            s.reserve(op->sources().size());
 
-            d = narrow_node::clone_from(op->d());
+            d = narrow_of(ctx, op->d());
             for (const auto& source: op->sources())
-                s.push_back(narrow_node::clone_from(source));
+                s.push_back(narrow_of(ctx, source));
 
             auto ptr = libflo::operation<narrow_node>::create(d,
                                                               op->width_u(),
@@ -96,20 +140,22 @@ out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
     case libflo::opcode::IN:
 #endif
     {
-        for (size_t i = 0; i < op->d()->nnode_count(); ++i) {
-            auto d = op->d()->nnode(i);
+        for (size_t i = 0; i < op->d()->nnode_count(ctx); ++i) {
+            const auto& d = op->d()->nnode(ctx, i);
 
             std::vector<std::shared_ptr<narrow_node>> svec;
-            for (const auto s: op->sources()) {
+            for (const auto& s: op->sources()) {
                 /* This makes MUX work: the idea is that if the width
                  * is 1 (like MUX's select signal is) then we'll
                  * always pick the first node.  Note that this is
                  * perfectly fine in the general case because that's
-                 * what would be picked anyway! */
-                if (s->width() == 1)
-                    svec.push_back(s->nnode(0));
+                 * what would be picked anyway!  The same goes for the
+                 * address of a memory that's wider than a word, which
+                 * every word shares. */
+                if (s->width() == 1 || s->nnode_count(ctx) == 1)
+                    svec.push_back(s->nnode(ctx, 0));
                 else
-                    svec.push_back(s->nnode(i));
+                    svec.push_back(s->nnode(ctx, i));
             }
 
             auto ptr = libflo::operation<narrow_node>::create(d,
@@ -124,12 +170,12 @@ out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
 
     case libflo::opcode::REG:
     {
-        for (size_t i = 0; i < op->d()->nnode_count(); ++i) {
-            auto d = op->d()->nnode(i);
+        for (size_t i = 0; i < op->d()->nnode_count(ctx); ++i) {
+            const auto& d = op->d()->nnode(ctx, i);
 
             std::vector<std::shared_ptr<narrow_node>> svec;
             svec.push_back(narrow_node::create_const(d, 1));
-            svec.push_back(op->t()->nnode(i));
+            svec.push_back(op->t()->nnode(ctx, i));
 
             auto ptr = libflo::operation<narrow_node>::create(d,
                                                               d->width_u(),
@@ -156,10 +202,10 @@ out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
         out.push_back(wide_op);
 
         /* Now we actually go ahead and do all the CAT nodes. */
-        for (size_t i = 0; i < op->d()->nnode_count(); ++i) {
-            auto d = op->d()->nnode(i);
+        for (size_t i = 0; i < op->d()->nnode_count(ctx); ++i) {
+            const auto& d = op->d()->nnode(ctx, i);
 
-            auto offset = i * wide_node::get_word_length();
+            auto offset = i * width;
             auto offsetc = narrow_node::create_const(d, offset);
 
             auto rshd_op = libflo::operation<narrow_node>::create(
@@ -182,24 +228,29 @@ out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
     case libflo::opcode::ADD:
     case libflo::opcode::SUB:
     {
+        if (adder != adder_strategy::RIPPLE) {
+            narrow_add(out, ctx, op, adder);
+            break;
+        }
+
         /* Here we generate the carry bit, which is initially zero. */
-        auto c = narrow_node::create_temp(op->s()->nnode(0));
+        auto c = narrow_node::create_temp(op->s()->nnode(ctx, 0));
         {
             auto c_op = libflo::operation<narrow_node>::create(
                 c,
                 c->width_u(),
                 libflo::opcode::XOR,
-                {op->s()->nnode(0), op->s()->nnode(0)}
+                {op->s()->nnode(ctx, 0), op->s()->nnode(ctx, 0)}
                 );
             out.push_back(c_op);
         }
 
         /* Walk through the D <= S + T node arrays, creating a sum at
          * each step and producing another carry bit. */
-        for (size_t i = 0; i < op->d()->nnode_count(); ++i) {
-            auto d = op->d()->nnode(i);
-            auto s = op->s()->nnode(i);
-            auto t = op->t()->nnode(i);
+        for (size_t i = 0; i < op->d()->nnode_count(ctx); ++i) {
+            const auto& d = op->d()->nnode(ctx, i);
+            const auto& s = op->s()->nnode(ctx, i);
+            const auto& t = op->t()->nnode(ctx, i);
 
             /* The carry operation is really only a bit, so here we
              * just need to cast it to our width. */
@@ -413,14 +464,14 @@ out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
 
             /* We walk the list of output nodes to ensure that they
              * all end up filled out at some point. */
-            for (size_t i = 0; i < op->d()->nnode_count(); ++i) {
-                auto d = op->d()->nnode(i);
+            for (size_t i = 0; i < op->d()->nnode_count(ctx); ++i) {
+                const auto& d = op->d()->nnode(ctx, i);
                 auto noffset = (op->op() == libflo::opcode::LSH) 
                     ? i * width - offset : i * width + offset;
 
-                bfext(d, out, width, wide_s, noffset, d->width());
+                bfext(d, out, ctx, wide_s, noffset, d->width());
             }
-        } else {
+        } else if (shift_by_words(out, ctx, op) == false) {
             std::vector<std::shared_ptr<libflo::operation<wide_node>>> wout;
 
             /* A variable shift is decomposed to a bunch of constant
@@ -484,12 +535,10 @@ out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
                 );
             wout.push_back(mov_op);
 
-            for (const auto& wop: wout) {
-                wop->writeln_debug(stderr);
-
-                for (const auto& op: narrow_op(wop, width, false))
+            for (const auto& wop: wout)
+                for (const auto& op: narrow_op(wop, ctx, adder, karatsuba,
+                                               false))
                     out.push_back(op);
-            }
         }
 
         break;
@@ -506,7 +555,8 @@ out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
             libflo::opcode::LSH,
             {op->s(), offset}
             );
-        for (const auto& op: narrow_op(shift_op, width, false))
+        for (const auto& op: narrow_op(shift_op, ctx, adder, karatsuba,
+                                       false))
             out.push_back(op);
 
         auto extended = wide_node::create_temp(op->d());
@@ -517,7 +567,8 @@ out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
             libflo::opcode::RSH,
             {op->t(), zero}
             );
-        for (const auto& op: narrow_op(extend_op, width, false))
+        for (const auto& op: narrow_op(extend_op, ctx, adder, karatsuba,
+                                       false))
             out.push_back(op);
 
         auto d = op->d();
@@ -527,7 +578,8 @@ out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
             libflo::opcode::OR,
             {shifted, extended}
             );
-        for (const auto& op: narrow_op(or_op, width, false))
+        for (const auto& op: narrow_op(or_op, ctx, adder, karatsuba,
+                                       false))
             out.push_back(op);
 
         break;
@@ -536,123 +588,12 @@ out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
         /* Multiplication has more custom splitting rules. */
     case libflo::opcode::MUL:
     {
-        if (op->s()->width() != op->t()->width()) {
-            fprintf(stderr, "Multiplication with different operand widths\n");
+        if (width % 2 != 0) {
+            fprintf(stderr, "Multiplication needs an even word width\n");
             abort();
         }
 
-        if (op->s()->nnode_count() != 1) {
-            fprintf(stderr, "Multiplication with more than one word\n");
-            abort();
-        }
-
-        auto full_width = op->s()->width();
-        auto half_width = op->s()->width() / 2;
-
-        /* We need to split the inputs up into half-width operations,
-         * as that's the only way to do a full-precision multiply. */
-        auto sl = bfext(out, full_width, op->s(), 0, half_width);
-        auto sh = bfext(out, full_width, op->s(), half_width, half_width);
-        auto tl = bfext(out, full_width, op->t(), 0, half_width);
-        auto th = bfext(out, full_width, op->t(), half_width, half_width);
-
-        /* Now that we've got these half-words, we need to multiply
-         * them all together.  These are guarnteed to be narrow
-         * operations because they're at most half width. */
-        auto mul = [&](std::shared_ptr<narrow_node>& a,
-                       std::shared_ptr<narrow_node>& b)
-            -> std::shared_ptr<narrow_node>
-            {
-                auto p = narrow_node::create_temp(full_width);
-                auto p_op = libflo::operation<narrow_node>::create(
-                    p,
-                    full_width,
-                    libflo::opcode::MUL,
-                    {a, b}
-                    );
-                out.push_back(p_op);
-                return p;
-            };
-        auto sltl = mul(sl, tl);
-        auto shtl = mul(sh, tl);
-        auto slth = mul(sl, th);
-        auto shth = mul(sh, th);
-
-        /* At this point we're going to start generating some wide
-         * operations, which will then get passed back through the
-         * multi-word expander. */
-        auto wide_ops =
-            std::vector<std::shared_ptr<libflo::operation<wide_node>>>();
-
-        /* Expands the given node such that it will fill the full
-         * output width.  This pads the MSB with zeros and the LSB
-         * with zeros, for the length of that offset. */
-        auto expand = [&](std::shared_ptr<narrow_node>& n,
-                          size_t offset)
-            -> std::shared_ptr<wide_node>
-            {
-                auto nw = wide_node::clone_from(n);
-
-                auto zero = wide_node::create_const(nw, offset);
-
-                auto nwo = wide_node::create_temp(nw->width() * 2);
-                auto nwo_op = libflo::operation<wide_node>::create(
-                    nwo,
-                    nwo->width(),
-                    (offset == 0) ? libflo::opcode::RSH : libflo::opcode::LSH,
-                    {nw, zero}
-                    );
-                wide_ops.push_back(nwo_op);
-
-                return nwo;
-            };
-        auto sltle = expand(sltl, 0*half_width);
-        auto shtle = expand(shtl, 1*half_width);
-        auto slthe = expand(slth, 1*half_width);
-        auto shshe = expand(shth, 2*half_width);
-
-        /* At this point we just need to sum up every word. */
-        auto sum = [&](std::vector<std::shared_ptr<wide_node>> values)
-            -> std::shared_ptr<wide_node>
-            {
-                std::shared_ptr<wide_node> s = NULL;
-
-                for (auto& value: values) {
-                    if (s == NULL) {
-                        s = value;
-                    } else {
-                        auto ns = wide_node::create_temp(s);
-                        auto ns_op = libflo::operation<wide_node>::create(
-                            ns,
-                            ns->width(),
-                            libflo::opcode::ADD,
-                            {s, value}
-                            );
-                        wide_ops.push_back(ns_op);
-                        s = ns;
-                    }
-                }
-
-                return s;
-            };
-        auto total = sum({sltle, shtle, slthe, shshe});
-
-        std::shared_ptr<wide_node> d = op->d();
-        auto mov_op = libflo::operation<wide_node>::create(
-            d,
-            d->width(),
-            libflo::opcode::MOV,
-            {total}
-            );
-        wide_ops.push_back(mov_op);
-
-        /* Pass every wide op we generated through the multi-word
-         * expander to produce more operations! */
-        for (const auto& wide_op: wide_ops) {
-            for (const auto& op: narrow_op(wide_op, width, false))
-                out.push_back(op);
-        }
-
+        multiply(out, ctx, adder, karatsuba, op->d(), op->s(), op->t());
         break;
     }
 
@@ -668,7 +609,8 @@ out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
             {zero, op->s()}
             );
 
-        for (const auto& op: narrow_op(sub_op, width, false))
+        for (const auto& op: narrow_op(sub_op, ctx, adder, karatsuba,
+                                       false))
             out.push_back(op);
 
         break;
@@ -705,9 +647,9 @@ out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
         }
 
         /* Now walk through and check every word for equality. */
-        for (size_t i = 0; i < op->s()->nnode_count(); ++i) {
-            auto s = op->s()->nnode(i);
-            auto t = op->t()->nnode(i);
+        for (size_t i = 0; i < op->s()->nnode_count(ctx); ++i) {
+            const auto& s = op->s()->nnode(ctx, i);
+            const auto& t = op->t()->nnode(ctx, i);
 
             auto cur = narrow_node::create_temp(reduction);
             auto cur_op = libflo::operation<narrow_node>::create(
@@ -734,7 +676,7 @@ out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
 
         /* Finally go and overwrite the output node. */
         {
-            auto d = op->d()->nnode(0);
+            const auto& d = op->d()->nnode(ctx, 0);
             auto mov_op = libflo::operation<narrow_node>::create(
                 d,
                 d->width_u(),
@@ -770,9 +712,9 @@ out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
         /* Here's the reduction.  Essentially we compute the value at
          * every word and pass through the old value if the current
          * words are equal. */
-        for (size_t i = 0; i < op->s()->nnode_count(); ++i) {
-            auto s = op->s()->nnode(i);
-            auto t = op->t()->nnode(i);
+        for (size_t i = 0; i < op->s()->nnode_count(ctx); ++i) {
+            const auto& s = op->s()->nnode(ctx, i);
+            const auto& t = op->t()->nnode(ctx, i);
 
             auto cur = narrow_node::create_temp(reduction);
             auto cur_op = libflo::operation<narrow_node>::create(
@@ -806,7 +748,7 @@ out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
 
         /* Finally go and overwrite the output node. */
         {
-            auto d = op->d()->nnode(0);
+            const auto& d = op->d()->nnode(ctx, 0);
             auto mov_op = libflo::operation<narrow_node>::create(
                 d,
                 d->width_u(),
@@ -837,8 +779,8 @@ out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
         }
 
         /* Here's the actual reduction code. */
-        for (size_t i = 0; i < op->s()->nnode_count(); ++i) {
-            auto s = op->s()->nnode(i);
+        for (size_t i = 0; i < op->s()->nnode_count(ctx); ++i) {
+            const auto& s = op->s()->nnode(ctx, i);
 
             auto cur = narrow_node::create_temp(reduction);
             auto cur_op = libflo::operation<narrow_node>::create(
@@ -906,8 +848,8 @@ out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
                 );
             out.push_back(sign_word_op);
 
-            for (size_t i = 0; i < op->d()->nnode_count(); ++i) {
-                auto d = op->d()->nnode(i);
+            for (size_t i = 0; i < op->d()->nnode_count(ctx); ++i) {
+                const auto& d = op->d()->nnode(ctx, i);
                 auto s = (i == 0) ? reduction : sign_word;
 
                 auto mov_op = libflo::operation<narrow_node>::create(
@@ -944,7 +886,7 @@ out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
     /* Here's an early out: if there's only one destination node then
      * there's no reason to bother emiting a CATD to put them
      * together. */
-    if (op->d()->nnode_count() == 1)
+    if (op->d()->nnode_count(ctx) == 1)
         return out;
 
     /* IN nodes aren't handled with a CATD at all. */
@@ -957,31 +899,22 @@ out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
 
     /* We now need to CATD together a bunch of nodes such that they
      * produce exactly the same result as the wide operation would.
-     * This mapping is not produced for all configurations. */
+     * This mapping is not produced for all configurations.  Nothing
+     * in the output ever reads these nodes, but the harness looks up
+     * wide nodes by their original names, so the chain has to stay.
+     * The chain starts from the lowest word itself rather than from a
+     * copy of it. */
 
 #ifdef MAPPING
     /* This contains the previous node in the chain. */
-    std::shared_ptr<narrow_node> prev = NULL;
-
-    for (size_t i = 0; i < op->d()->nnode_count(); ++i) {
-        if (prev == NULL) {
-            prev = op->d()->catdnode(i);
-
-            auto ptr = libflo::operation<narrow_node>
-                ::create(prev,
-                         prev->width_u(),
-                         libflo::opcode::MOV,
-                         {op->d()->nnode(0)}
-                    );
-            out.push_back(ptr);
-            continue;
-        }
+    std::shared_ptr<narrow_node> prev = op->d()->nnode(ctx, 0);
 
-        auto next = op->d()->catdnode(i);
+    for (size_t i = 1; i < op->d()->nnode_count(ctx); ++i) {
+        auto next = op->d()->catdnode(ctx, i);
         auto ptr = libflo::operation<narrow_node>::create(next,
                                                           next->width_u(),
                                                           libflo::opcode::CATD,
-                                                          {op->d()->nnode(i),
+                                                          {op->d()->nnode(ctx, i),
                                                                   prev}
             );
         out.push_back(ptr);
@@ -993,36 +926,38 @@ out_t narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
 }
 
 std::shared_ptr<narrow_node> bfext(out_t& out,
-                                   size_t width,
+                                   const expand_context& ctx,
                                    const std::shared_ptr<wide_node>& w,
                                    ssize_t offset,
                                    size_t count)
 {
     auto n = narrow_node::create_temp(count);
-    bfext(n, out, width, w, offset, count);
+    bfext(n, out, ctx, w, offset, count);
     return n;
 }
 
-void bfext(std::shared_ptr<narrow_node>& n,
+void bfext(const std::shared_ptr<narrow_node>& n,
            out_t& out,
-           size_t width,
+           const expand_context& ctx,
            const std::shared_ptr<wide_node>& w,
            ssize_t offset,
            size_t count)
 {
+    const size_t width = ctx.word_length();
+
     ssize_t lo_word = offset / (ssize_t)width;
     ssize_t hi_word = (offset + (ssize_t)count - 1) / (ssize_t)width;
     auto direction = (offset >= 0) ? libflo::opcode::RSH : libflo::opcode::LSH;
 
     if (lo_word == hi_word) {
-        if (lo_word < (ssize_t)w->nnode_count() && lo_word >= 0) {
+        if (lo_word < (ssize_t)w->nnode_count(ctx) && lo_word >= 0) {
             auto moffset = (offset >= 0)
                 ? offset % width : width - (offset % width);
             auto rsh_op = libflo::operation<narrow_node>::create(
                 n,
                 n->width_u(),
                 direction,
-                {w->nnode(lo_word), narrow_node::create_const(moffset)}
+                {w->nnode(ctx, lo_word), narrow_node::create_const(moffset)}
                 );
             out.push_back(rsh_op);
         } else {
@@ -1038,15 +973,15 @@ void bfext(std::shared_ptr<narrow_node>& n,
     } else if (hi_word == (lo_word + 1)) {
         auto lo_offset = offset % width;
 
-        auto lo_width = (lo_word < (ssize_t)w->nnode_count() && lo_word >= 0)
-            ? w->nnode(lo_word)->width() - lo_offset : n->width();
+        auto lo_width = (lo_word < (ssize_t)w->nnode_count(ctx) && lo_word >= 0)
+            ? w->nnode(ctx, lo_word)->width() - lo_offset : n->width();
         auto lo_dat = narrow_node::create_temp(lo_width);
-        if (lo_word < (ssize_t)w->nnode_count() && lo_word >= 0) {
+        if (lo_word < (ssize_t)w->nnode_count(ctx) && lo_word >= 0) {
             auto lo_op = libflo::operation<narrow_node>::create(
                 lo_dat,
                 lo_dat->width_u(),
                 direction,
-                {w->nnode(lo_word), narrow_node::create_const(lo_offset)}
+                {w->nnode(ctx, lo_word), narrow_node::create_const(lo_offset)}
                 );
             out.push_back(lo_op);
         } else {
@@ -1063,12 +998,12 @@ void bfext(std::shared_ptr<narrow_node>& n,
         if (hi_word > 0) {
             auto hi_width = n->width() - lo_width;
             auto hi_dat = narrow_node::create_temp(hi_width);
-            if (hi_word < (ssize_t)w->nnode_count() && hi_word >= 0) {
+            if (hi_word < (ssize_t)w->nnode_count(ctx) && hi_word >= 0) {
                 auto hi_op = libflo::operation<narrow_node>::create(
                     hi_dat,
                     hi_dat->width_u(),
                     direction,
-                    {w->nnode(hi_word), narrow_node::create_const(0)}
+                    {w->nnode(ctx, hi_word), narrow_node::create_const(0)}
                     );
                 out.push_back(hi_op);
             } else {
@@ -1107,3 +1042,499 @@ void bfext(std::shared_ptr<narrow_node>& n,
         abort();
     }
 }
+
+bool shift_by_words(out_t& out,
+                    const expand_context& ctx,
+                    const std::shared_ptr<libflo::operation<wide_node>>& op)
+{
+    const size_t width = ctx.word_length();
+
+    size_t bits = 0;
+    while (((size_t)1 << bits) < width)
+        bits++;
+
+    if (bits == 0 || ((size_t)1 << bits) != width)
+        return false;
+    if (op->t()->nnode_count(ctx) != 1)
+        return false;
+
+    auto emit = [&](const std::shared_ptr<narrow_node>& d,
+                    libflo::opcode opcode,
+                    std::vector<std::shared_ptr<narrow_node>> s)
+        {
+            auto ptr = libflo::operation<narrow_node>::create(d,
+                                                              d->width_u(),
+                                                              opcode,
+                                                              s);
+            out.push_back(ptr);
+        };
+
+    const bool left = (op->op() == libflo::opcode::LSH);
+    const auto& t = op->t()->nnode(ctx, 0);
+    const size_t t_width = op->t()->width();
+    const size_t in_words = op->s()->nnode_count(ctx);
+    const size_t out_words = op->d()->nnode_count(ctx);
+
+    /* Once the amount is at least this many words every word has been
+     * shifted out, so those bits of the amount don't need a stage in
+     * the word-select network -- they just clear the result. */
+    const size_t span = left ? out_words : in_words;
+    size_t stages = 0;
+    while (bits + stages < t_width && ((size_t)1 << stages) < span)
+        stages++;
+
+    auto lo = narrow_node::create_temp(bits);
+    emit(lo, libflo::opcode::RSH, {t, narrow_node::create_const(0)});
+
+    std::vector<std::shared_ptr<narrow_node>> selects;
+    for (size_t i = 0; i < stages; ++i) {
+        auto select = narrow_node::create_temp(1);
+        emit(select, libflo::opcode::RSH,
+             {t, narrow_node::create_const(bits + i)});
+        selects.push_back(select);
+    }
+
+    std::shared_ptr<narrow_node> overflow = NULL;
+    if (bits + stages < t_width) {
+        auto high = narrow_node::create_temp(t_width - bits - stages);
+        emit(high, libflo::opcode::RSH,
+             {t, narrow_node::create_const(bits + stages)});
+
+        overflow = narrow_node::create_temp(1);
+        auto overflow_op = libflo::operation<narrow_node>::create(
+            overflow,
+            high->width_u(),
+            libflo::opcode::NEQ,
+            {high, narrow_node::create_const(high, 0)}
+            );
+        out.push_back(overflow_op);
+    }
+
+    /* The word-select network works on full words, NULL stands for a
+     * word that's known to be zero.  A partial top word gets
+     * zero-extended first. */
+    std::vector<std::shared_ptr<narrow_node>> words(span);
+    for (size_t i = 0; i < span && i < in_words; ++i) {
+        if (op->s()->nnode(ctx, i)->width() == width)
+            words[i] = op->s()->nnode(ctx, i);
+        else
+            words[i] = bfext(out, ctx, op->s(), i * width, width);
+    }
+
+    for (size_t stage = 0; stage < stages; ++stage) {
+        const size_t step = (size_t)1 << stage;
+
+        std::vector<std::shared_ptr<narrow_node>> next(span);
+        for (size_t i = 0; i < span; ++i) {
+            std::shared_ptr<narrow_node> from = NULL;
+            if (left && i >= step)
+                from = words[i - step];
+            else if (!left && i + step < span)
+                from = words[i + step];
+
+            if (from == NULL && words[i] == NULL)
+                continue;
+
+            next[i] = narrow_node::create_temp(width);
+            auto zero = narrow_node::create_const(next[i], 0);
+            emit(next[i], libflo::opcode::MUX,
+                 {selects[stage],
+                  (from == NULL) ? zero : from,
+                  (words[i] == NULL) ? zero : words[i]});
+        }
+
+        words.swap(next);
+    }
+
+    /* Each output word gets the selected word shifted by the low bits,
+     * along with the bits that crossed over from its neighbour.
+     * Shifting the neighbour by one and then by the complement of the
+     * low bits avoids ever shifting by the full word width. */
+    const auto near_op = left ? libflo::opcode::LSH : libflo::opcode::RSH;
+    const auto far_op = left ? libflo::opcode::RSH : libflo::opcode::LSH;
+
+    auto lo_inv = narrow_node::create_temp(bits);
+    emit(lo_inv, libflo::opcode::NOT, {lo});
+
+    for (size_t i = 0; i < out_words; ++i) {
+        const auto& d = op->d()->nnode(ctx, i);
+        auto result = (overflow == NULL) ? d : narrow_node::create_temp(d);
+
+        std::shared_ptr<narrow_node> near = NULL;
+        if (i < span)
+            near = words[i];
+
+        std::shared_ptr<narrow_node> far = NULL;
+        if (left && i >= 1 && i - 1 < span)
+            far = words[i - 1];
+        else if (!left && i + 1 < span)
+            far = words[i + 1];
+
+        std::shared_ptr<narrow_node> near_part = NULL;
+        if (near != NULL) {
+            near_part = (far == NULL) ? result
+                                      : narrow_node::create_temp(width);
+            emit(near_part, near_op, {near, lo});
+        }
+
+        if (far != NULL) {
+            auto far_one = narrow_node::create_temp(width);
+            emit(far_one, far_op, {far, narrow_node::create_const(1)});
+
+            auto far_part = (near == NULL) ? result
+                                           : narrow_node::create_temp(width);
+            emit(far_part, far_op, {far_one, lo_inv});
+
+            if (near != NULL)
+                emit(result, libflo::opcode::OR, {near_part, far_part});
+        }
+
+        if (near == NULL && far == NULL)
+            emit(result, libflo::opcode::MOV,
+                 {narrow_node::create_const(result, 0)});
+
+        if (overflow != NULL)
+            emit(d, libflo::opcode::MUX,
+                 {overflow, narrow_node::create_const(d, 0), result});
+    }
+
+    return true;
+}
+
+void multiply(out_t& out,
+              const expand_context& ctx,
+              adder_strategy adder,
+              size_t karatsuba,
+              const std::shared_ptr<wide_node>& d,
+              std::shared_ptr<wide_node> s,
+              std::shared_ptr<wide_node> t)
+{
+    const size_t width = ctx.word_length();
+
+    typedef std::shared_ptr<wide_node> wide_ptr;
+
+    /* Every wide operation generated here gets passed straight back
+     * through the multi-word expander, which is where the recursion
+     * happens. */
+    auto emit = [&](const wide_ptr& wd,
+                    libflo::opcode opcode,
+                    std::vector<wide_ptr> ws)
+        {
+            auto wop = libflo::operation<wide_node>::create(wd,
+                                                            wd->width_u(),
+                                                            opcode,
+                                                            ws);
+            for (const auto& op: narrow_op(wop, ctx, adder, karatsuba,
+                                           false))
+                out.push_back(op);
+        };
+
+    /* Truncates or zero-extends a node to the given width. */
+    auto resize = [&](const wide_ptr& n, size_t w) -> wide_ptr
+        {
+            if (n->width() == w)
+                return n;
+
+            auto r = wide_node::create_temp(w);
+            emit(r, libflo::opcode::RSH, {n, wide_node::create_const(r, 0)});
+            return r;
+        };
+
+    /* Bits above the result's width can never affect it. */
+    const size_t d_width = d->width();
+    if (s->width() > d_width)
+        s = resize(s, d_width);
+    if (t->width() > d_width)
+        t = resize(t, d_width);
+
+    auto words = [&](const wide_ptr& n) -> size_t
+        { return (n->width() + width - 1) / width; };
+
+    const size_t n = (words(s) > words(t)) ? words(s) : words(t);
+    const size_t half = (n + 1) / 2;
+    if (n <= karatsuba || words(s) <= half || words(t) <= half) {
+        schoolbook(out, ctx, adder, karatsuba, d, s, t);
+        return;
+    }
+
+    /* Karatsuba's trick: with S = S1 * 2^k + S0 (and the same for T)
+     *   S * T = Z2 * 2^2k + Z1 * 2^k + Z0
+     * where Z0 = S0 * T0, Z2 = S1 * T1 and
+     *   Z1 = (S0 + S1) * (T0 + T1) - Z0 - Z2
+     * which only takes three multiplications instead of four.  Every
+     * part only needs to be as wide as the bits of D that it lands
+     * in, and the wrap-around in Z1's subtractions doesn't matter
+     * because Z1 is really never negative. */
+    const size_t k = half * width;
+
+    auto low = [&](const wide_ptr& n) -> wide_ptr
+        { return resize(n, k); };
+    auto high = [&](const wide_ptr& n) -> wide_ptr
+        {
+            auto r = wide_node::create_temp(n->width() - k);
+            emit(r, libflo::opcode::RSH, {n, wide_node::create_const(r, k)});
+            return r;
+        };
+    auto s0 = low(s), s1 = high(s);
+    auto t0 = low(t), t1 = high(t);
+
+    auto min = [](size_t a, size_t b) -> size_t { return (a < b) ? a : b; };
+    const size_t z1_width = min(d_width - k, 2 * k + 2);
+
+    auto z0 = wide_node::create_temp(min(2 * k, d_width));
+    emit(z0, libflo::opcode::MUL, {s0, t0});
+
+    auto z2 = wide_node::create_temp(min(s1->width() + t1->width(),
+                                         z1_width));
+    emit(z2, libflo::opcode::MUL, {s1, t1});
+
+    auto ss = wide_node::create_temp(k + 1);
+    emit(ss, libflo::opcode::ADD, {resize(s0, k + 1), resize(s1, k + 1)});
+    auto ts = wide_node::create_temp(k + 1);
+    emit(ts, libflo::opcode::ADD, {resize(t0, k + 1), resize(t1, k + 1)});
+
+    auto z1p = wide_node::create_temp(z1_width);
+    emit(z1p, libflo::opcode::MUL, {ss, ts});
+    auto z1m = wide_node::create_temp(z1_width);
+    emit(z1m, libflo::opcode::SUB, {z1p, resize(z0, z1_width)});
+    auto z1 = wide_node::create_temp(z1_width);
+    emit(z1, libflo::opcode::SUB, {z1m, resize(z2, z1_width)});
+
+    /* Z0 and Z2 don't overlap, so they're just concatenated. */
+    auto outer = z0;
+    if (d_width > 2 * k) {
+        outer = wide_node::create_temp(d_width);
+        emit(outer, libflo::opcode::CAT, {resize(z2, d_width - 2 * k), z0});
+    }
+
+    auto middle = wide_node::create_temp(d_width);
+    emit(middle, libflo::opcode::LSH,
+         {z1, wide_node::create_const(middle, k)});
+
+    emit(d, libflo::opcode::ADD, {resize(outer, d_width), middle});
+}
+
+void schoolbook(out_t& out,
+                const expand_context& ctx,
+                adder_strategy adder,
+                size_t karatsuba,
+                const std::shared_ptr<wide_node>& d,
+                const std::shared_ptr<wide_node>& s,
+                const std::shared_ptr<wide_node>& t)
+{
+    const size_t width = ctx.word_length();
+
+    typedef std::shared_ptr<narrow_node> narrow_ptr;
+
+    auto emit = [&](const narrow_ptr& nd,
+                    libflo::opcode opcode,
+                    std::vector<narrow_ptr> ns)
+        {
+            auto ptr = libflo::operation<narrow_node>::create(nd,
+                                                              nd->width_u(),
+                                                              opcode,
+                                                              ns);
+            out.push_back(ptr);
+        };
+
+    /* The sources are split into half-word limbs, so the product of
+     * any two limbs fits in a word. */
+    const size_t h = width / 2;
+    auto limbs = [&](const std::shared_ptr<wide_node>& w)
+        -> std::vector<narrow_ptr>
+        {
+            std::vector<narrow_ptr> l;
+            for (size_t offset = 0; offset < w->width(); offset += h) {
+                auto count = w->width() - offset;
+                l.push_back(bfext(out, ctx, w, offset,
+                                  (count < h) ? count : h));
+            }
+            return l;
+        };
+    auto sl = limbs(s);
+    auto tl = limbs(t);
+
+    /* Every product is split into its low limb, which lands in the
+     * column of the result that's the sum of the two limb indices,
+     * and its high limb, which lands in the next column up.  Products
+     * that can only land in the top column aren't split, the bits
+     * they'd carry out of it are thrown away anyway. */
+    const size_t d_width = d->width();
+    const size_t columns = (d_width + h - 1) / h;
+    std::vector<std::vector<narrow_ptr>> parts(columns);
+    for (size_t i = 0; i < sl.size() && i < columns; ++i) {
+        for (size_t j = 0; j < tl.size() && i + j < columns; ++j) {
+            auto p = narrow_node::create_temp(width);
+            emit(p, libflo::opcode::MUL, {sl[i], tl[j]});
+
+            if (i + j + 1 == columns ||
+                sl[i]->width() + tl[j]->width() <= h) {
+                parts[i + j].push_back(p);
+                continue;
+            }
+
+            auto lo = narrow_node::create_temp(width);
+            emit(lo, libflo::opcode::AND,
+                 {p, narrow_node::create_const(p, ((size_t)1 << h) - 1)});
+            parts[i + j].push_back(lo);
+
+            auto hi = narrow_node::create_temp(width);
+            emit(hi, libflo::opcode::RSH, {p, narrow_node::create_const(h)});
+            parts[i + j + 1].push_back(hi);
+        }
+    }
+
+    /* Each column is summed up with a tree of narrow additions.  A
+     * word holds the sum of 2^h limbs without overflowing, so any
+     * more than that get split into separate sums.  This is the
+     * carry-save part: the carries out of every column are kept as
+     * a second row instead of being propagated. */
+    const size_t fits = (h < 8 * sizeof(size_t) - 1)
+        ? ((size_t)1 << h) : (size_t)-1;
+    std::vector<std::vector<narrow_ptr>> sums;
+    std::vector<std::vector<bool>> carries;
+    for (size_t c = 0; c < columns; ++c) {
+        for (size_t first = 0; first < parts[c].size(); first += fits) {
+            size_t last = (parts[c].size() - first > fits)
+                ? first + fits : parts[c].size();
+
+            std::vector<narrow_ptr> level(parts[c].begin() + first,
+                                          parts[c].begin() + last);
+            while (level.size() > 1) {
+                std::vector<narrow_ptr> next;
+                for (size_t i = 0; i + 1 < level.size(); i += 2) {
+                    auto sum = narrow_node::create_temp(width);
+                    emit(sum, libflo::opcode::ADD, {level[i], level[i + 1]});
+                    next.push_back(sum);
+                }
+                if (level.size() % 2 == 1)
+                    next.push_back(level.back());
+                level = next;
+            }
+
+            size_t chunk = first / fits;
+            if (sums.size() <= chunk) {
+                sums.push_back(std::vector<narrow_ptr>(columns));
+                carries.push_back(std::vector<bool>(columns, false));
+            }
+            sums[chunk][c] = level[0];
+
+            /* Every part other than the unsplit products in the top
+             * column fits in a limb, so a column only carries into
+             * the next one when it had to add something up. */
+            carries[chunk][c] = (last - first > 1) && (c + 1 < columns);
+        }
+    }
+
+    /* A column's sum turns into one limb of a low row and, if it
+     * could have overflowed a limb, one limb of a high row.  Limbs
+     * are pairs of a column sum and a shift, NULL is a zero limb. */
+    typedef std::pair<narrow_ptr, size_t> limb;
+    std::vector<std::vector<limb>> rows;
+    for (size_t chunk = 0; chunk < sums.size(); ++chunk) {
+        std::vector<limb> lo(columns, limb(NULL, 0));
+        std::vector<limb> hi(columns, limb(NULL, 0));
+        bool any_hi = false;
+        for (size_t c = 0; c < columns; ++c) {
+            if (sums[chunk][c] == NULL)
+                continue;
+
+            lo[c] = limb(sums[chunk][c], 0);
+            if (carries[chunk][c]) {
+                hi[c + 1] = limb(sums[chunk][c], h);
+                any_hi = true;
+            }
+        }
+
+        rows.push_back(lo);
+        if (any_hi)
+            rows.push_back(hi);
+    }
+
+    /* Builds a wide node out of a row's limbs, two to a word. */
+    auto extract = [&](const narrow_ptr& nd, const limb& l)
+        {
+            emit(nd, libflo::opcode::RSH,
+                 {l.first, narrow_node::create_const(l.second)});
+        };
+    auto build = [&](const std::shared_ptr<wide_node>& w,
+                     const std::vector<limb>& row)
+        {
+            for (size_t i = 0; i < w->nnode_count(ctx); ++i) {
+                const auto& word = w->nnode(ctx, i);
+                const size_t word_width = word->width();
+                const limb& lo = row[2 * i];
+
+                if (word_width <= h) {
+                    if (lo.first == NULL)
+                        emit(word, libflo::opcode::MOV,
+                             {narrow_node::create_const(word, 0)});
+                    else
+                        extract(word, lo);
+                    continue;
+                }
+
+                const limb& hi = row[2 * i + 1];
+                if (lo.first == NULL && hi.first == NULL) {
+                    emit(word, libflo::opcode::MOV,
+                         {narrow_node::create_const(word, 0)});
+                    continue;
+                }
+
+                auto half = [&](const limb& l, size_t w) -> narrow_ptr
+                    {
+                        if (l.first == NULL)
+                            return narrow_node::create_const(w, 0);
+
+                        auto n = narrow_node::create_temp(w);
+                        extract(n, l);
+                        return n;
+                    };
+                emit(word, libflo::opcode::CAT,
+                     {half(hi, word_width - h), half(lo, h)});
+            }
+        };
+
+    /* Finally the rows get added together, which is the only place a
+     * carry has to go all the way across the result. */
+    if (rows.size() == 1) {
+        build(d, rows[0]);
+        return;
+    }
+
+    std::vector<std::shared_ptr<wide_node>> level;
+    for (const auto& row: rows) {
+        auto w = wide_node::create_temp(d_width);
+        build(w, row);
+        level.push_back(w);
+    }
+
+    while (level.size() > 1) {
+        std::vector<std::shared_ptr<wide_node>> next;
+        for (size_t i = 0; i + 1 < level.size(); i += 2) {
+            auto sum = (level.size() == 2) ? d : wide_node::create_temp(d);
+            auto add_op = libflo::operation<wide_node>::create(
+                sum,
+                sum->width_u(),
+                libflo::opcode::ADD,
+                {level[i], level[i + 1]}
+                );
+            for (const auto& op: narrow_op(add_op, ctx, adder, karatsuba,
+                                           false))
+                out.push_back(op);
+            next.push_back(sum);
+        }
+        if (level.size() % 2 == 1)
+            next.push_back(level.back());
+        level = next;
+    }
+}
+
+std::shared_ptr<narrow_node> narrow_of(const expand_context& ctx,
+                                       const std::shared_ptr<wide_node>& w)
+{
+    if (w->nnode_count(ctx) == 1)
+        return w->nnode(ctx, 0);
+
+    return narrow_node::clone_from(w);
+}
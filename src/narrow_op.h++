@@ -22,6 +22,8 @@
 #ifndef NARROW_OP_HXX
 #define NARROW_OP_HXX
 
+#include "adder.h++"
+#include "expand_context.h++"
 #include "narrow_node.h++"
 #include "wide_node.h++"
 #include <libflo/operation.h++>
@@ -29,6 +31,7 @@
 
 std::vector<std::shared_ptr<libflo::operation<narrow_node>>>
 narrow_op(const std::shared_ptr<libflo::operation<wide_node>> op,
-          size_t width, bool emit_catd = true);
+          const expand_context& ctx, adder_strategy adder,
+          size_t karatsuba, bool emit_catd = true);
 
 #endif
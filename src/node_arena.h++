@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2014 Palmer Dabbelt
+ *   <palmer.dabbelt@eecs.berkeley.edu>
+ *
+ * This file is part of flo-mwe.
+ *
+ * flo-mwe is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * flo-mwe is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with flo-mwe.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NODE_ARENA_HXX
+#define NODE_ARENA_HXX
+
+#include <memory>
+#include <new>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <utility>
+#include <vector>
+
+/* A read-only view of some consecutive nodes in an arena, which is
+ * what the node mappings are handed out as.  Views are just a pointer
+ * and a count, so passing them around never copies (or reference
+ * counts) any nodes. */
+template<class node_t> class node_span {
+public:
+    typedef std::shared_ptr<node_t> node_ptr;
+
+private:
+    const node_ptr *_first;
+    uint32_t _count;
+
+public:
+    node_span(const node_ptr *first, uint32_t count)
+        : _first(first),
+          _count(count)
+        {
+        }
+
+public:
+    size_t size(void) const { return _count; }
+    const node_ptr& operator[](size_t i) const { return _first[i]; }
+    const node_ptr *begin(void) const { return _first; }
+    const node_ptr *end(void) const { return _first + _count; }
+};
+
+/* Stores every node that a single wider (or deeper) node maps to.
+ * The nodes themselves are built in one contiguous allocation and
+ * are addressed by their index in it, rather than each one being
+ * allocated on its own.  libflo holds nodes by shared_ptr, so each
+ * node also gets a handle -- but all those handles share a single
+ * reference count, which keeps the whole arena alive for as long as
+ * any of its nodes are used anywhere.  Most nodes map to exactly one
+ * node, so that case skips the block and just allocates that node
+ * on its own. */
+template<class node_t> class node_arena {
+public:
+    typedef std::shared_ptr<node_t> node_ptr;
+
+private:
+    /* The storage for the nodes, which destroys exactly as many of
+     * them as have been built. */
+    struct block {
+        node_t *nodes;
+        size_t built;
+
+        block(size_t count)
+            : nodes((node_t *)::operator new(count * sizeof(node_t))),
+              built(0)
+            {
+            }
+
+        ~block(void)
+            {
+                for (size_t i = 0; i < built; ++i)
+                    nodes[i].~node_t();
+                ::operator delete(nodes);
+            }
+
+        block(const block&) = delete;
+        block& operator=(const block&) = delete;
+    };
+
+    /* Points either at "_single" or at an array of handles into
+     * "_block", depending on how many nodes there are.  The handles
+     * are what keep the block alive. */
+    node_ptr *_handles;
+    block *_block;
+    uint32_t _count;
+    uint32_t _built;
+    node_ptr _single;
+
+public:
+    node_arena(void)
+        : _handles(NULL),
+          _block(NULL),
+          _count(0),
+          _built(0),
+          _single()
+        {
+        }
+
+    ~node_arena(void)
+        {
+            if (_count > 1)
+                delete[] _handles;
+        }
+
+    node_arena(const node_arena&) = delete;
+    node_arena& operator=(const node_arena&) = delete;
+
+public:
+    /* Makes room for exactly "count" nodes, which has to be done
+     * (once) before any are built.  The handles all point into the
+     * block from the start, but nothing can see them until every
+     * node has been built. */
+    void reserve(size_t count)
+        {
+            _count = count;
+            if (count <= 1) {
+                _handles = &_single;
+                return;
+            }
+
+            auto b = std::make_shared<block>(count);
+            _block = b.get();
+            _handles = new node_ptr[count];
+            for (size_t i = 0; i < count; ++i)
+                _handles[i] = node_ptr(b, b->nodes + i);
+        }
+
+    /* Builds the next node in place, passing every argument on to its
+     * constructor. */
+    template<class... args_t>
+    const node_ptr& emplace(args_t&&... args)
+        {
+            if (_built == _count) {
+                fprintf(stderr, "Built more nodes than were reserved\n");
+                abort();
+            }
+
+            if (_count == 1) {
+                _single = std::make_shared<node_t>(
+                    std::forward<args_t>(args)...);
+                return _handles[_built++];
+            }
+
+            node_t *n = _block->nodes + _built;
+            new (n) node_t(std::forward<args_t>(args)...);
+            _block->built++;
+            return _handles[_built++];
+        }
+
+    size_t size(void) const { return _built; }
+    const node_ptr& operator[](size_t i) const { return _handles[i]; }
+
+    /* Returns a view of every node in this arena. */
+    node_span<node_t> span(void) const
+        { return node_span<node_t>(_handles, _built); }
+};
+
+#endif
@@ -0,0 +1,502 @@
+/*
+ * Copyright (C) 2014 Palmer Dabbelt
+ *   <palmer.dabbelt@eecs.berkeley.edu>
+ *
+ * This file is part of flo-mwe.
+ *
+ * flo-mwe is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * flo-mwe is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with flo-mwe.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "optimize.h++"
+#include "temp_namespace.h++"
+#include <algorithm>
+#include <libflo/sizet_printf.h++>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+#include <unordered_map>
+
+typedef std::shared_ptr<libflo::operation<shallow_node>> op_ptr;
+typedef std::shared_ptr<shallow_node> node_ptr;
+
+/* Returns TRUE if an operation has no effect other than producing its
+ * result, which means it can be removed when nothing uses that. */
+static bool is_pure(libflo::opcode op);
+
+/* Returns TRUE if an operation can be evaluated at expansion time or
+ * merged with an identical one. */
+static bool is_foldable(libflo::opcode op);
+
+/* Returns TRUE if the order of an operation's sources doesn't
+ * matter. */
+static bool is_commutative(libflo::opcode op);
+
+/* Returns TRUE if the width of source "i" of an operation changes its
+ * result.  Constants are written out without a width, so they can
+ * never be substituted there. */
+static bool needs_width(libflo::opcode op, size_t i);
+
+/* Returns TRUE if "n" is a constant that fits in its width, storing
+ * its value. */
+static bool const_value(const node_ptr& n, uint64_t& value);
+
+/* Computes the result of an operation on "s" at expansion time,
+ * returning FALSE if that's not possible. */
+static bool fold(const op_ptr& op, const std::vector<node_ptr>& s,
+                 uint64_t& value);
+
+/* Returns the source that an operation on "s" just copies, or NULL if
+ * it's not a copy. */
+static node_ptr copy_of(const op_ptr& op, const std::vector<node_ptr>& s);
+
+/* Builds the key that identical operations on "s" share. */
+static std::string expression(const op_ptr& op,
+                              const std::vector<node_ptr>& s);
+
+optimize_stats& optimize_stats::operator+=(const optimize_stats& other)
+{
+    folded += other.folded;
+    merged += other.merged;
+    copies += other.copies;
+    dead += other.dead;
+    return *this;
+}
+
+void optimize_stats::print(FILE *f) const
+{
+    fprintf(f, "Operations removed by the optimizer:\n");
+    fprintf(f, "  constant folding:   " SIZET_FORMAT "\n", folded);
+    fprintf(f, "  common expressions: " SIZET_FORMAT "\n", merged);
+    fprintf(f, "  copy propagation:   " SIZET_FORMAT "\n", copies);
+    fprintf(f, "  dead code:          " SIZET_FORMAT "\n", dead);
+    fprintf(f, "  total:              " SIZET_FORMAT "\n",
+            folded + merged + copies + dead);
+}
+
+void optimize(std::vector<op_ptr>& ops, optimize_stats& stats)
+{
+    /* Everything the optimizer knows about a temporary is kept in one
+     * place so that each use costs a single lookup. */
+    struct temp_info {
+        node_ptr replacement;
+        size_t *removed_by;
+        size_t uses;
+        size_t definition;
+        bool removable;
+    };
+    std::unordered_map<std::string, temp_info> temps;
+    temps.reserve(ops.size());
+
+    /* Follows a chain of replacements, stopping short of a constant
+     * when the width has to be kept. */
+    auto resolve = [&](node_ptr n, bool keep_width) -> node_ptr
+        {
+            while (temp_namespace::is_temp(n->name())) {
+                auto found = temps.find(n->name());
+                if (found == temps.end() || found->second.replacement == NULL)
+                    break;
+                if (keep_width && found->second.replacement->is_const())
+                    break;
+                n = found->second.replacement;
+            }
+            return n;
+        };
+
+    /* Rewrites an operation to use the current replacement of each of
+     * its sources, and fills "s" with what every source is known to
+     * be (which can be a constant even where the operation itself
+     * has to keep using a node). */
+    auto rewrite = [&](op_ptr& op, std::vector<node_ptr>& s) -> void
+        {
+            s.clear();
+            std::vector<node_ptr> sources;
+            bool changed = false;
+            for (const auto& source: op->sources()) {
+                s.push_back(resolve(source, false));
+                if (needs_width(op->op(), sources.size()))
+                    sources.push_back(resolve(source, true));
+                else
+                    sources.push_back(s.back());
+                if (sources.back() != source)
+                    changed = true;
+            }
+
+            if (changed) {
+                op = libflo::operation<shallow_node>::create(op->d(),
+                                                             op->width_u(),
+                                                             op->op(),
+                                                             sources);
+            }
+        };
+
+    auto replace = [&](size_t i, const node_ptr& with, size_t& rule) -> void
+        {
+            auto& info = temps[ops[i]->d()->name()];
+            info.replacement = with;
+            info.removed_by = &rule;
+            info.definition = i;
+        };
+
+    /* The first pass goes through every operation in order, replacing
+     * the temporaries that it can. */
+    std::unordered_map<std::string, node_ptr> expressions;
+    expressions.reserve(ops.size());
+    std::vector<bool> removed(ops.size(), false);
+    std::vector<node_ptr> s;
+
+    for (size_t i = 0; i < ops.size(); ++i) {
+        rewrite(ops[i], s);
+
+        const auto& op = ops[i];
+        if (!is_foldable(op->op()))
+            continue;
+
+        bool temp = temp_namespace::is_temp(op->d()->name());
+
+        uint64_t value;
+        if (temp && fold(op, s, value)) {
+            replace(i, shallow_node::create_const(op->d(), value),
+                    stats.folded);
+            removed[i] = true;
+            stats.folded++;
+            continue;
+        }
+
+        auto copy = copy_of(op, s);
+        if (temp && copy != NULL) {
+            replace(i, copy, stats.copies);
+            removed[i] = true;
+            stats.copies++;
+            continue;
+        }
+
+        auto key = expression(op, s);
+        auto found = expressions.find(key);
+        if (found == expressions.end()) {
+            expressions[key] = op->d();
+        } else if (temp) {
+            replace(i, found->second, stats.merged);
+            removed[i] = true;
+            stats.merged++;
+        }
+    }
+    expressions.clear();
+
+    /* Temporaries are almost always defined before they're used, but
+     * that's not guaranteed, so there's a second pass to catch any
+     * uses that came first.  This also counts the uses of every
+     * temporary.  A temporary that became a constant but is still
+     * used where its width matters is put back, as a move of that
+     * constant. */
+    for (size_t i = 0; i < ops.size(); ++i) {
+        if (removed[i])
+            continue;
+
+        rewrite(ops[i], s);
+        for (const auto& source: ops[i]->sources()) {
+            if (!temp_namespace::is_temp(source->name()))
+                continue;
+
+            auto& info = temps[source->name()];
+            info.uses++;
+
+            if (info.replacement == NULL || !removed[info.definition])
+                continue;
+
+            const size_t d = info.definition;
+            ops[d] = libflo::operation<shallow_node>::create(
+                ops[d]->d(),
+                ops[d]->width_u(),
+                libflo::opcode::MOV,
+                {info.replacement}
+                );
+            removed[d] = false;
+            (*info.removed_by)--;
+            info.removable = true;
+        }
+
+        if (is_pure(ops[i]->op()) &&
+            temp_namespace::is_temp(ops[i]->d()->name())) {
+            auto& info = temps[ops[i]->d()->name()];
+            info.definition = i;
+            info.removable = true;
+        }
+    }
+
+    /* Dead temporaries are removed, which can make the temporaries
+     * they used dead as well. */
+    std::vector<size_t> dead;
+    for (const auto& temp: temps)
+        if (temp.second.removable && temp.second.uses == 0)
+            dead.push_back(temp.second.definition);
+
+    while (!dead.empty()) {
+        size_t i = dead.back();
+        dead.pop_back();
+
+        if (removed[i])
+            continue;
+        removed[i] = true;
+        stats.dead++;
+
+        for (const auto& source: ops[i]->sources()) {
+            if (!temp_namespace::is_temp(source->name()))
+                continue;
+
+            auto& info = temps[source->name()];
+            if (--info.uses == 0 && info.removable)
+                dead.push_back(info.definition);
+        }
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < ops.size(); ++i)
+        if (!removed[i])
+            ops[kept++] = ops[i];
+    ops.resize(kept);
+}
+
+bool is_pure(libflo::opcode op)
+{
+    return is_foldable(op) || op == libflo::opcode::RD;
+}
+
+bool is_foldable(libflo::opcode op)
+{
+    switch (op) {
+    case libflo::opcode::ADD:
+    case libflo::opcode::AND:
+    case libflo::opcode::CAT:
+    case libflo::opcode::EQ:
+    case libflo::opcode::GTE:
+    case libflo::opcode::LSH:
+    case libflo::opcode::LT:
+    case libflo::opcode::MOV:
+    case libflo::opcode::MUL:
+    case libflo::opcode::MUX:
+    case libflo::opcode::NEG:
+    case libflo::opcode::NEQ:
+    case libflo::opcode::NOT:
+    case libflo::opcode::OR:
+    case libflo::opcode::RSH:
+    case libflo::opcode::SUB:
+    case libflo::opcode::XOR:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+bool needs_width(libflo::opcode op, size_t i)
+{
+    switch (op) {
+    case libflo::opcode::CAT:
+    case libflo::opcode::CATD:
+        return true;
+
+    case libflo::opcode::ARSH:
+        return i == 0;
+
+    default:
+        return false;
+    }
+}
+
+bool is_commutative(libflo::opcode op)
+{
+    switch (op) {
+    case libflo::opcode::ADD:
+    case libflo::opcode::AND:
+    case libflo::opcode::EQ:
+    case libflo::opcode::MUL:
+    case libflo::opcode::NEQ:
+    case libflo::opcode::OR:
+    case libflo::opcode::XOR:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+static uint64_t mask(uint64_t value, size_t width)
+{
+    if (width >= 64)
+        return value;
+    return value & (((uint64_t)1 << width) - 1);
+}
+
+bool const_value(const node_ptr& n, uint64_t& value)
+{
+    if (!n->is_const() || !n->width_u().known() || n->width() > 64)
+        return false;
+
+    value = strtoull(n->name().c_str(), NULL, 0);
+    return mask(value, n->width()) == value;
+}
+
+bool fold(const op_ptr& op, const std::vector<node_ptr>& s, uint64_t& value)
+{
+    if (!op->d()->width_u().known() || op->d()->width() > 64)
+        return false;
+    const size_t width = op->d()->width();
+
+    std::vector<uint64_t> v(s.size());
+    std::vector<bool> known(s.size());
+    bool all_known = true;
+    for (size_t i = 0; i < s.size(); ++i) {
+        known[i] = const_value(s[i], v[i]);
+        all_known = all_known && known[i];
+    }
+
+    /* A few operations are constant as long as one of their sources
+     * is. */
+    if (op->op() == libflo::opcode::AND || op->op() == libflo::opcode::MUL) {
+        for (size_t i = 0; i < s.size(); ++i) {
+            if (known[i] && v[i] == 0) {
+                value = 0;
+                return true;
+            }
+        }
+    }
+
+    if (op->op() == libflo::opcode::LSH && known[1] && v[1] >= width) {
+        value = 0;
+        return true;
+    }
+
+    if (op->op() == libflo::opcode::RSH && known[1] &&
+        s[0]->width_u().known() && v[1] >= s[0]->width()) {
+        value = 0;
+        return true;
+    }
+
+    if (all_known == false)
+        return false;
+
+    uint64_t r;
+    switch (op->op()) {
+    case libflo::opcode::ADD: r = v[0] + v[1]; break;
+    case libflo::opcode::AND: r = v[0] & v[1]; break;
+    case libflo::opcode::EQ:  r = (v[0] == v[1]); break;
+    case libflo::opcode::GTE: r = (v[0] >= v[1]); break;
+    case libflo::opcode::LT:  r = (v[0] < v[1]); break;
+    case libflo::opcode::MOV: r = v[0]; break;
+    case libflo::opcode::MUL: r = v[0] * v[1]; break;
+    case libflo::opcode::MUX: r = (v[0] & 1) ? v[1] : v[2]; break;
+    case libflo::opcode::NEG: r = -v[0]; break;
+    case libflo::opcode::NEQ: r = (v[0] != v[1]); break;
+    case libflo::opcode::NOT: r = ~v[0]; break;
+    case libflo::opcode::OR:  r = v[0] | v[1]; break;
+    case libflo::opcode::SUB: r = v[0] - v[1]; break;
+    case libflo::opcode::XOR: r = v[0] ^ v[1]; break;
+
+    case libflo::opcode::LSH:
+        r = (v[1] >= 64) ? 0 : (v[0] << v[1]);
+        break;
+
+    case libflo::opcode::RSH:
+        r = (v[1] >= 64) ? 0 : (v[0] >> v[1]);
+        break;
+
+    case libflo::opcode::CAT:
+        if (s[1]->width() >= 64)
+            r = v[1];
+        else
+            r = (v[0] << s[1]->width()) | v[1];
+        break;
+
+    default:
+        return false;
+    }
+
+    value = mask(r, width);
+    return true;
+}
+
+node_ptr copy_of(const op_ptr& op, const std::vector<node_ptr>& s)
+{
+    uint64_t v0 = 0, v1 = 0;
+    bool k0 = (s.size() > 0) && const_value(s[0], v0);
+    bool k1 = (s.size() > 1) && const_value(s[1], v1);
+
+    node_ptr copy = NULL;
+    switch (op->op()) {
+    case libflo::opcode::MOV:
+        copy = s[0];
+        break;
+
+    case libflo::opcode::LSH:
+    case libflo::opcode::RSH:
+    case libflo::opcode::SUB:
+        if (k1 && v1 == 0)
+            copy = s[0];
+        break;
+
+    case libflo::opcode::ADD:
+    case libflo::opcode::OR:
+    case libflo::opcode::XOR:
+        if (k1 && v1 == 0)
+            copy = s[0];
+        else if (k0 && v0 == 0)
+            copy = s[1];
+        break;
+
+    case libflo::opcode::MUX:
+        if (k0)
+            copy = (v0 & 1) ? s[1] : s[2];
+        else if (s[1]->name() == s[2]->name())
+            copy = s[1];
+        break;
+
+    default:
+        break;
+    }
+
+    /* A copy that changes the width is really a truncation or an
+     * extension, which has to stay. */
+    if (copy == NULL || !copy->width_u().known() ||
+        !op->d()->width_u().known() || copy->width() != op->d()->width())
+        return NULL;
+
+    return copy;
+}
+
+std::string expression(const op_ptr& op, const std::vector<node_ptr>& s)
+{
+    std::vector<std::string> sources;
+    sources.reserve(s.size());
+    for (const auto& source: s) {
+        sources.push_back(source->name());
+        sources.back() += '\'';
+        sources.back() += std::to_string(source->width_u().known()
+                                         ? source->width() : 0);
+    }
+
+    if (is_commutative(op->op()))
+        std::sort(sources.begin(), sources.end());
+
+    std::string key = libflo::opcode_to_string(op->op());
+    key += '\'';
+    key += std::to_string(op->width_u().known() ? op->width() : 0);
+    key += '\'';
+    key += std::to_string(op->d()->width_u().known() ? op->d()->width() : 0);
+    for (const auto& source: sources) {
+        key += ' ';
+        key += source;
+    }
+    return key;
+}
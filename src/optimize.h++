@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2014 Palmer Dabbelt
+ *   <palmer.dabbelt@eecs.berkeley.edu>
+ *
+ * This file is part of flo-mwe.
+ *
+ * flo-mwe is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * flo-mwe is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with flo-mwe.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPTIMIZE_HXX
+#define OPTIMIZE_HXX
+
+#include "shallow_node.h++"
+#include <libflo/operation.h++>
+#include <stdio.h>
+#include <vector>
+
+/* The optimizer is run over the expansions of this many consecutive
+ * wide operations at a time (counting from the first operation in the
+ * file), both when streaming and when the whole design is expanded at
+ * once.  That keeps the output the same in both modes. */
+#define OPTIMIZE_BATCH_SIZE 1024
+
+/* Counts the operations that each of the optimizer's rules removed. */
+struct optimize_stats {
+    size_t folded;      /* Constant folding */
+    size_t merged;      /* Common subexpression elimination */
+    size_t copies;      /* Copy propagation */
+    size_t dead;        /* Dead code elimination */
+
+    optimize_stats(void) : folded(0), merged(0), copies(0), dead(0) {}
+
+    optimize_stats& operator+=(const optimize_stats& other);
+
+    /* Writes a human-readable report. */
+    void print(FILE *f) const;
+};
+
+/* Cleans up the shallow operations produced by an expansion: a lot of
+ * them are moves, operations on constants, or the same bit-field
+ * extraction done again.  This folds constants, merges identical
+ * operations, propagates copies and then drops anything that's no
+ * longer used.  Only temporaries are ever removed or renamed, every
+ * other node is left exactly as it was.  Every temporary that's used
+ * in "ops" has to be defined in "ops" as well, which is always the
+ * case when "ops" contains the whole expansion of some set of wide
+ * operations. */
+void optimize(std::vector<std::shared_ptr<libflo::operation<shallow_node>>>& ops,
+              optimize_stats& stats);
+
+#endif
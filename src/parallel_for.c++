@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2014 Palmer Dabbelt
+ *   <palmer.dabbelt@eecs.berkeley.edu>
+ *
+ * This file is part of flo-mwe.
+ *
+ * flo-mwe is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * flo-mwe is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with flo-mwe.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "parallel_for.h++"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+void parallel_for(size_t count, size_t jobs,
+                  const std::function<void(size_t)>& func)
+{
+    /* There's no reason to start up any threads when there's nothing
+     * for them to do. */
+    if (jobs <= 1 || count <= 1) {
+        for (size_t i = 0; i < count; ++i)
+            func(i);
+        return;
+    }
+
+    if (jobs > count)
+        jobs = count;
+
+    /* Chunks are small enough that every thread gets a bunch of them
+     * (so the tail balances out), but large enough that the shared
+     * counter doesn't get hammered. */
+    size_t chunk = count / (jobs * 16);
+    if (chunk < 1)
+        chunk = 1;
+    if (chunk > 256)
+        chunk = 256;
+
+    std::atomic<size_t> next(0);
+    auto worker = [&](void) -> void
+        {
+            while (true) {
+                size_t start = next.fetch_add(chunk);
+                if (start >= count)
+                    return;
+
+                size_t end = start + chunk;
+                if (end > count)
+                    end = count;
+
+                for (size_t i = start; i < end; ++i)
+                    func(i);
+            }
+        };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < jobs; ++i)
+        threads.push_back(std::thread(worker));
+
+    worker();
+
+    for (auto& thread: threads)
+        thread.join();
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2014 Palmer Dabbelt
+ *   <palmer.dabbelt@eecs.berkeley.edu>
+ *
+ * This file is part of flo-mwe.
+ *
+ * flo-mwe is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * flo-mwe is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with flo-mwe.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARALLEL_FOR_HXX
+#define PARALLEL_FOR_HXX
+
+#include <functional>
+#include <stddef.h>
+
+/* Calls "func" once for every index in [0, count), using up to "jobs"
+ * threads (including the calling one).  Indices are handed out in
+ * small chunks to whichever thread is idle, so a few expensive
+ * indices don't leave the other threads waiting.  There's no ordering
+ * guarantee between calls, so anything that cares about order should
+ * store its results by index. */
+void parallel_for(size_t count, size_t jobs,
+                  const std::function<void(size_t)>& func);
+
+#endif
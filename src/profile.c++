@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2014 Palmer Dabbelt
+ *   <palmer.dabbelt@eecs.berkeley.edu>
+ *
+ * This file is part of flo-mwe.
+ *
+ * flo-mwe is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * flo-mwe is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with flo-mwe.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "profile.h++"
+#include <libflo/sizet_printf.h++>
+#include <chrono>
+#include <sys/resource.h>
+
+/* The counters are indexed by libflo's own opcode numbers, so there's
+ * no list of opcodes here to keep up to date.  This is far more than
+ * libflo has ever had, anything past it is only counted in the
+ * totals. */
+#define OPCODE_SLOTS 128
+
+static const char *phase_names[PROFILE_PHASE_COUNT] = {
+    "parse_ns",
+    "narrow_op_ns",
+    "split_mem_ns",
+    "write_ns",
+};
+
+profile::profile(size_t width, size_t depth)
+    : _opcodes(new counters[OPCODE_SLOTS]),
+      _width(width),
+      _depth(depth),
+      _start(now())
+{
+    for (size_t i = 0; i < OPCODE_SLOTS; ++i) {
+        for (size_t p = 0; p < PROFILE_PHASE_COUNT; ++p)
+            _opcodes[i].ns[p] = 0;
+        _opcodes[i].wide_in = 0;
+        _opcodes[i].shallow_out = 0;
+        _opcodes[i].written = 0;
+    }
+
+    for (size_t i = 0; i < TEMP_FAMILY_COUNT; ++i)
+        _temps[i] = 0;
+
+    for (size_t p = 0; p < PROFILE_PHASE_COUNT; ++p)
+        _total_ns[p] = 0;
+}
+
+profile::~profile(void)
+{
+    delete[] _opcodes;
+}
+
+uint64_t profile::now(void)
+{
+    auto t = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+}
+
+void profile::add_time(profile_phase phase, libflo::opcode op, uint64_t ns)
+{
+    if ((size_t)op < OPCODE_SLOTS)
+        _opcodes[(size_t)op].ns[(size_t)phase] += ns;
+    _total_ns[(size_t)phase] += ns;
+}
+
+void profile::add_time(profile_phase phase, uint64_t ns)
+{
+    _total_ns[(size_t)phase] += ns;
+}
+
+void profile::add_expansion(libflo::opcode op, size_t shallow)
+{
+    if ((size_t)op >= OPCODE_SLOTS)
+        return;
+
+    auto& c = _opcodes[(size_t)op];
+    c.wide_in++;
+    c.shallow_out += shallow;
+}
+
+void profile::add_written(libflo::opcode op)
+{
+    if ((size_t)op < OPCODE_SLOTS)
+        _opcodes[(size_t)op].written++;
+}
+
+void profile::add_temps(const temp_namespace& ns)
+{
+    for (size_t i = 0; i < TEMP_FAMILY_COUNT; ++i)
+        _temps[i] += ns.count((temp_family)i);
+}
+
+void profile::write_json(FILE *f) const
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"width\": " SIZET_FORMAT ",\n", _width);
+    fprintf(f, "  \"depth\": " SIZET_FORMAT ",\n", _depth);
+    fprintf(f, "  \"wall_ns\": %llu,\n",
+            (unsigned long long)(now() - _start));
+    fprintf(f, "  \"peak_rss_kb\": %ld,\n", usage.ru_maxrss);
+
+    fprintf(f, "  \"phases\": {");
+    for (size_t p = 0; p < PROFILE_PHASE_COUNT; ++p) {
+        fprintf(f, "%s\"%s\": %llu",
+                (p == 0) ? "" : ", ",
+                phase_names[p],
+                (unsigned long long)_total_ns[p].load());
+    }
+    fprintf(f, "},\n");
+
+    /* Opcodes that never showed up are left out, there's a lot of
+     * them. */
+    fprintf(f, "  \"opcodes\": {");
+    bool first = true;
+    for (size_t i = 0; i < OPCODE_SLOTS; ++i) {
+        const auto& c = _opcodes[i];
+        if (c.wide_in == 0 && c.written == 0 && c.ns[0] == 0)
+            continue;
+
+        fprintf(f, "%s\n    \"%s\": {", first ? "" : ",",
+                libflo::opcode_to_string((libflo::opcode)i).c_str());
+        fprintf(f, "\"wide_in\": %llu, \"shallow_out\": %llu, "
+                "\"written\": %llu",
+                (unsigned long long)c.wide_in.load(),
+                (unsigned long long)c.shallow_out.load(),
+                (unsigned long long)c.written.load());
+        for (size_t p = 0; p < PROFILE_PHASE_COUNT; ++p) {
+            fprintf(f, ", \"%s\": %llu",
+                    phase_names[p],
+                    (unsigned long long)c.ns[p].load());
+        }
+        fprintf(f, "}");
+        first = false;
+    }
+    fprintf(f, "\n  },\n");
+
+    fprintf(f, "  \"temps\": {");
+    for (size_t i = 0; i < TEMP_FAMILY_COUNT; ++i) {
+        fprintf(f, "%s\"%s\": %llu",
+                (i == 0) ? "" : ", ",
+                temp_namespace::prefix((temp_family)i),
+                (unsigned long long)_temps[i].load());
+    }
+    fprintf(f, "}\n");
+    fprintf(f, "}\n");
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2014 Palmer Dabbelt
+ *   <palmer.dabbelt@eecs.berkeley.edu>
+ *
+ * This file is part of flo-mwe.
+ *
+ * flo-mwe is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * flo-mwe is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with flo-mwe.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROFILE_HXX
+#define PROFILE_HXX
+
+#include "temp_namespace.h++"
+#include <atomic>
+#include <libflo/opcode.h++>
+#include <stdint.h>
+#include <stdio.h>
+
+/* The phases of an expansion that are timed separately.  Every one
+ * of them is charged to the opcode of the operation it was working
+ * on: wide opcodes for parsing, narrow_op() and split_mem(), and
+ * shallow opcodes for writing. */
+enum class profile_phase {
+    PARSE,
+    NARROW,
+    SPLIT_MEM,
+    WRITE,
+};
+#define PROFILE_PHASE_COUNT 4
+
+/* Collects where the time goes while expanding a design for one
+ * target, along with how much each sort of operation expands.  Every
+ * counter can be added to from any number of threads at once. */
+class profile {
+private:
+    struct counters {
+        std::atomic<uint64_t> ns[PROFILE_PHASE_COUNT];
+        std::atomic<uint64_t> wide_in;
+        std::atomic<uint64_t> shallow_out;
+        std::atomic<uint64_t> written;
+    };
+
+    counters *_opcodes;
+    std::atomic<uint64_t> _temps[TEMP_FAMILY_COUNT];
+    std::atomic<uint64_t> _total_ns[PROFILE_PHASE_COUNT];
+    const size_t _width;
+    const size_t _depth;
+    const uint64_t _start;
+
+public:
+    /* The target's word length and memory depth label the JSON. */
+    profile(size_t width, size_t depth);
+    ~profile(void);
+
+    /* Returns the current time, in nanoseconds since some arbitrary
+     * point. */
+    static uint64_t now(void);
+
+    /* Charges "ns" nanoseconds of the given phase to an opcode. */
+    void add_time(profile_phase phase, libflo::opcode op, uint64_t ns);
+
+    /* Charges a whole phase that can't be split up by opcode, which
+     * is how the in-memory parser gets timed. */
+    void add_time(profile_phase phase, uint64_t ns);
+
+    /* Records that one wide operation with the given opcode was
+     * expanded into "shallow" shallow operations. */
+    void add_expansion(libflo::opcode op, size_t shallow);
+
+    /* Records that a shallow operation was written out. */
+    void add_written(libflo::opcode op);
+
+    /* Records every temporary that was named by "ns". */
+    void add_temps(const temp_namespace& ns);
+
+    /* Writes everything that's been collected as a JSON object,
+     * along with the peak resident set size of this process (which
+     * covers every target that was expanded at the same time). */
+    void write_json(FILE *f) const;
+};
+
+#endif
@@ -20,6 +20,7 @@
  */
 
 #include "shallow_node.h++"
+#include "temp_namespace.h++"
 #include <libflo/sizet_printf.h++>
 
 #ifndef LINE_MAX
@@ -35,62 +36,48 @@ shallow_node::shallow_node(const std::string name,
                            const libflo::unknown<std::string>& posn)
     : libflo::node(name, width, depth, is_mem, is_const, cycle, posn)
 {
-    if (this->depth() > wide_node::get_mem_depth()) {
-        fprintf(stderr, "Attempted to build a shallow that's too deep\n");
-        abort();
-    }
 }
 
 std::shared_ptr<shallow_node>
 shallow_node::clone_from(std::shared_ptr<narrow_node> w)
 {
-    return std::shared_ptr<shallow_node>(new shallow_node(w->name(),
-                                                          w->width_u(),
-                                                          w->depth_u(),
-                                                          w->is_mem(),
-                                                          w->is_const(),
-                                                          w->dfdepth_u(),
-                                                          w->posn_u()));
+    return std::make_shared<shallow_node>(w->name(),
+                                          w->width_u(),
+                                          w->depth_u(),
+                                          w->is_mem(),
+                                          w->is_const(),
+                                          w->dfdepth_u(),
+                                          w->posn_u());
 }
 
 
 std::shared_ptr<shallow_node>
 shallow_node::create_temp(const std::shared_ptr<shallow_node> t)
 {
+    auto name = temp_namespace::next(temp_family::SHALLOW_TEMPLATE);
 
-    static unsigned long num = 0;
-
-    char name[LINE_MAX];
-    snprintf(name, LINE_MAX, "MWEsT%lu", num++);
-
-    return std::shared_ptr<shallow_node>(new shallow_node(name,
-                                                          t->width_u(),
-                                                          t->depth_u(),
-                                                          t->is_mem(),
-                                                          t->is_const(),
-                                                          t->dfdepth_u(),
-                                                          t->posn_u()
-                                             ));
+    return std::make_shared<shallow_node>(name,
+                                          t->width_u(),
+                                          t->depth_u(),
+                                          t->is_mem(),
+                                          t->is_const(),
+                                          t->dfdepth_u(),
+                                          t->posn_u());
 
 }
 
 std::shared_ptr<shallow_node>
 shallow_node::create_temp(const size_t width)
 {
-    static unsigned long num = 0;
-
-    char name[LINE_MAX];
-    snprintf(name, LINE_MAX, "MWEsW%lu", num++);
-
-    return std::shared_ptr<shallow_node>(
-        new shallow_node(name,
-                         width,
-                         0,
-                         false,
-                         false,
-                         libflo::unknown<size_t>(),
-                         libflo::unknown<std::string>()
-            ));
+    auto name = temp_namespace::next(temp_family::SHALLOW_WIDTH);
+
+    return std::make_shared<shallow_node>(name,
+                                          width,
+                                          0,
+                                          false,
+                                          false,
+                                          libflo::unknown<size_t>(),
+                                          libflo::unknown<std::string>());
 }
 
 std::shared_ptr<shallow_node>
@@ -99,14 +86,13 @@ shallow_node::create_const(const std::shared_ptr<shallow_node> t, size_t value)
     char name[LINE_MAX];
     snprintf(name, LINE_MAX, SIZET_FORMAT, value);
 
-    return std::shared_ptr<shallow_node>(new shallow_node(name,
-                                                          t->width_u(),
-                                                          0,
-                                                          false,
-                                                          true,
-                                                          0,
-                                                          libflo::unknown<std::string>()
-                                             ));
+    return std::make_shared<shallow_node>(name,
+                                          t->width_u(),
+                                          0,
+                                          false,
+                                          true,
+                                          0,
+                                          libflo::unknown<std::string>());
 }
 
 std::shared_ptr<shallow_node>
@@ -115,12 +101,11 @@ shallow_node::create_const(size_t width, size_t value)
     char name[LINE_MAX];
     snprintf(name, LINE_MAX, SIZET_FORMAT, value);
 
-    return std::shared_ptr<shallow_node>(new shallow_node(name,
-                                                          width,
-                                                          0,
-                                                          false,
-                                                          true,
-                                                          0,
-                                                          libflo::unknown<std::string>()
-                                             ));
+    return std::make_shared<shallow_node>(name,
+                                          width,
+                                          0,
+                                          false,
+                                          true,
+                                          0,
+                                          libflo::unknown<std::string>());
 }
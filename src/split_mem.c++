@@ -20,13 +20,31 @@
  */
 
 #include "split_mem.h++"
-#include <cmath>
 
 typedef std::vector<std::shared_ptr<libflo::operation<shallow_node>>> out_t;
 
+/* Returns the single shallow node that a narrow node maps to, reusing
+ * the narrow node's own mapping so that a node that's used by many
+ * operations only ends up with one shallow copy. */
+static std::shared_ptr<shallow_node>
+shallow_of(const expand_context& ctx, const std::shared_ptr<narrow_node>& n);
+
 out_t split_mem(const std::shared_ptr<libflo::operation<narrow_node>> op,
-                size_t depth)
+                const expand_context& ctx,
+                mem_split_strategy strategy,
+                const decoder_parts& parts)
 {
+    const size_t depth = ctx.mem_depth();
+
+    /* Only a CATD (or an IN that's split up afterwards) is ever
+     * allowed to produce something wider than a word. */
+    if (op->d()->width() > ctx.word_length() &&
+        op->op() != libflo::opcode::CATD &&
+        op->op() != libflo::opcode::IN) {
+        fprintf(stderr, "Attempted to build a narrow node wider than a word\n");
+        abort();
+    }
+
     /* Most node won't be too deep.  In order to avoid screwing
      * anything up I just output those nodes directly. */
     {
@@ -38,10 +56,11 @@ out_t split_mem(const std::shared_ptr<libflo::operation<narrow_node>> op,
         if (too_deep == false) {
             std::shared_ptr<shallow_node> d;
             std::vector<std::shared_ptr<shallow_node>> s;
+            s.reserve(op->sources().size());
 
-            d = shallow_node::clone_from(op->d());
+            d = shallow_of(ctx, op->d());
             for (const auto& source: op->sources())
-                s.push_back(shallow_node::clone_from(source));
+                s.push_back(shallow_of(ctx, source));
 
             out_t out;
             auto ptr = libflo::operation<shallow_node>::create(d,
@@ -58,80 +77,83 @@ out_t split_mem(const std::shared_ptr<libflo::operation<narrow_node>> op,
     case libflo::opcode::RD:
     {
         auto addr = shallow_node::clone_from(op->u());
-
-        size_t shift_count = std::log2(wide_node::get_mem_depth());
-        size_t addr_lo_width = shift_count;
-        size_t addr_hi_width = op->u()->width() - shift_count;
-
-        auto addr_lo = shallow_node::create_temp(addr_lo_width);
-        auto addr_lo_op = libflo::operation<shallow_node>::create(
-            addr_lo,
-            shift_count,
-            libflo::opcode::RSH,
-            {addr, shallow_node::create_const(addr, 0)}
-            );
-        out.push_back(addr_lo_op);
-
-        auto addr_hi = shallow_node::create_temp(addr_hi_width);
-        auto addr_hi_op = libflo::operation<shallow_node>::create(
-            addr_hi,
-            addr->width() - shift_count,
-            libflo::opcode::RSH,
-            {addr, shallow_node::create_const(addr, shift_count)}
-            );
-        out.push_back(addr_hi_op);
-
-        /* FIXME: This generates a linear-tree of MUXes, which is
-         * worse than the log-tree for large memories.  Note that this
-         * is actually better for small memories (I think, at
-         * least...?) and it's easier to write so I've stuck it in for
-         * now. */
-        size_t index = 0;
-        auto prev_node = shallow_node::create_temp(op->d()->snode(0));
-
-        for (const auto& mem: op->t()->snodes()) {
-            /* Load the memory into a new node. */
-            auto new_node = shallow_node::create_temp(prev_node);
+        bank_decoder decoder(addr, op->t()->depth(), depth);
+        bool tree = mem_split_use_tree(strategy, decoder.banks());
+
+        /* Constant addresses aren't shared, so this operation needs
+         * its own decoder. */
+        if (addr->is_const())
+            decoder.emit(out, {true, !tree, tree});
+        else
+            decoder.emit(out, parts);
+
+        /* Every bank is read at once, and then the right one gets
+         * selected afterwards. */
+        std::vector<std::shared_ptr<shallow_node>> values;
+        values.reserve(decoder.banks());
+        for (const auto& mem: op->t()->snodes(ctx)) {
+            auto value = shallow_node::create_temp(op->d()->snode(ctx, 0));
             auto load_op = libflo::operation<shallow_node>::create(
-                new_node,
-                new_node->width_u(),
+                value,
+                value->width_u(),
                 libflo::opcode::RD,
-                {shallow_node::create_const(1, 1), mem, addr_lo}
+                {shallow_node::create_const(1, 1), mem, decoder.lo()}
                 );
             out.push_back(load_op);
+            values.push_back(value);
+        }
 
-            /* If we're not the first node then check if there's a
-             * match -- this means that there's a fall-through to the
-             * first node when nothing matches. */
-            if (index > 0) {
-                auto index_const = shallow_node::create_const(addr_hi, index);
-
-                auto index_match = shallow_node::create_temp(1);
-                auto index_match_op = libflo::operation<shallow_node>::create(
-                    index_match,
-                    addr_hi->width_u(),
-                    libflo::opcode::EQ,
-                    {addr_hi, index_const}
-                    );
-                out.push_back(index_match_op);
-
-                auto mux_node = shallow_node::create_temp(new_node);
-                auto mux_op = libflo::operation<shallow_node>::create(
-                    mux_node,
-                    mux_node->width_u(),
-                    libflo::opcode::MUX,
-                    {index_match, new_node, prev_node}
-                    );
-                out.push_back(mux_op);
-                new_node = mux_node;
+        /* The tree picks between pairs of banks at each level using
+         * one bit of the bank number, so it's only log2(banks) deep.
+         * An odd bank out at any level just gets passed up to the
+         * next one. */
+        if (tree == true) {
+            for (size_t level = 0; values.size() > 1; ++level) {
+                std::vector<std::shared_ptr<shallow_node>> next;
+                next.reserve((values.size() + 1) / 2);
+
+                for (size_t i = 0; i < values.size(); i += 2) {
+                    if (i + 1 == values.size()) {
+                        next.push_back(values[i]);
+                        continue;
+                    }
+
+                    auto mux_node = (values.size() == 2)
+                        ? op->d()->snode(ctx, 0)
+                        : shallow_node::create_temp(values[i]);
+                    auto mux_op = libflo::operation<shallow_node>::create(
+                        mux_node,
+                        mux_node->width_u(),
+                        libflo::opcode::MUX,
+                        {decoder.select(level), values[i + 1], values[i]}
+                        );
+                    out.push_back(mux_op);
+                    next.push_back(mux_node);
+                }
+
+                values.swap(next);
             }
 
-            /* Rotate to the new node set. */
-            prev_node = new_node;
-            index++;
+            break;
         }
 
-        auto d = op->d()->snode(0);
+        /* The linear chain checks every bank other than the first
+         * one for a match, which means that there's a fall-through to
+         * the first bank when nothing matches. */
+        auto prev_node = values[0];
+        for (size_t i = 1; i < values.size(); ++i) {
+            auto mux_node = shallow_node::create_temp(values[i]);
+            auto mux_op = libflo::operation<shallow_node>::create(
+                mux_node,
+                mux_node->width_u(),
+                libflo::opcode::MUX,
+                {decoder.match(i), values[i], prev_node}
+                );
+            out.push_back(mux_op);
+            prev_node = mux_node;
+        }
+
+        const auto& d = op->d()->snode(ctx, 0);
         auto mov_op = libflo::operation<shallow_node>::create(
             d,
             prev_node->width_u(),
@@ -146,63 +168,32 @@ out_t split_mem(const std::shared_ptr<libflo::operation<narrow_node>> op,
     case libflo::opcode::WR:
     {
         auto addr = shallow_node::clone_from(op->u());
+        bank_decoder decoder(addr, op->t()->depth(), depth);
 
-        size_t shift_count = std::log2(wide_node::get_mem_depth());
-        size_t addr_lo_width = shift_count;
-        size_t addr_hi_width = op->u()->width() - shift_count;
+        if (addr->is_const())
+            decoder.emit(out, {true, true, false});
+        else
+            decoder.emit(out, parts);
 
-        auto addr_lo = shallow_node::create_temp(addr_lo_width);
-        auto addr_lo_op = libflo::operation<shallow_node>::create(
-            addr_lo,
-            shift_count,
-            libflo::opcode::RSH,
-            {addr, shallow_node::create_const(addr, 0)}
-            );
-        out.push_back(addr_lo_op);
-
-        auto addr_hi = shallow_node::create_temp(addr_hi_width);
-        auto addr_hi_op = libflo::operation<shallow_node>::create(
-            addr_hi,
-            addr->width() - shift_count,
-            libflo::opcode::RSH,
-            {addr, shallow_node::create_const(addr, shift_count)}
-            );
-        out.push_back(addr_hi_op);
-
-        /* FIXME: This generates a linear-tree of MUXes, which is
-         * worse than the log-tree for large memories.  Note that this
-         * is actually better for small memories (I think, at
-         * least...?) and it's easier to write so I've stuck it in for
-         * now. */
+        /* Every bank gets its own write, but only the one that the
+         * bank number matches is enabled. */
         size_t index = 0;
-
-        for (const auto& mem: op->t()->snodes()) {
-            auto index_const = shallow_node::create_const(addr_hi, index);
-
-            auto index_match = shallow_node::create_temp(1);
-            auto index_match_op = libflo::operation<shallow_node>::create(
-                index_match,
-                addr_hi->width_u(),
-                libflo::opcode::EQ,
-                {addr_hi, index_const}
-                );
-            out.push_back(index_match_op);
-
+        for (const auto& mem: op->t()->snodes(ctx)) {
             auto wen = shallow_node::create_temp(1);
             auto wen_op = libflo::operation<shallow_node>::create(
                 wen,
                 wen->width_u(),
                 libflo::opcode::AND,
-                {index_match, op->s()->snode(0)}
+                {decoder.match(index), op->s()->snode(ctx, 0)}
                 );
             out.push_back(wen_op);
 
-            auto write_node = shallow_node::create_temp(op->d()->snode(0));
+            auto write_node = shallow_node::create_temp(op->d()->snode(ctx, 0));
             auto write_op = libflo::operation<shallow_node>::create(
                 write_node,
                 write_node->width_u(),
                 libflo::opcode::WR,
-                {wen, mem, addr_lo, op->v()->snode(0)}
+                {wen, mem, decoder.lo(), op->v()->snode(ctx, 0)}
                 );
             out.push_back(write_op);
 
@@ -216,9 +207,9 @@ out_t split_mem(const std::shared_ptr<libflo::operation<narrow_node>> op,
     {
         size_t addr_hi = op->t()->const_int() / depth;
         size_t addr_lo = op->t()->const_int() % depth;
-        auto addr_loc = shallow_node::create_const(op->s()->snode(0), addr_lo);
+        auto addr_loc = shallow_node::create_const(op->s()->snode(ctx, 0), addr_lo);
 
-        if (addr_hi >= op->s()->snode_count()) {
+        if (addr_hi >= op->s()->snode_count(ctx)) {
             fprintf(stderr, "INIT shallow " SIZET_FORMAT " on %s\n",
                     addr_hi,
                     op->s()->name().c_str()
@@ -230,7 +221,7 @@ out_t split_mem(const std::shared_ptr<libflo::operation<narrow_node>> op,
             d,
             d->width_u(),
             libflo::opcode::INIT,
-            {op->s()->snode(addr_hi), addr_loc, op->u()->snode(0)}
+            {op->s()->snode(ctx, addr_hi), addr_loc, op->u()->snode(ctx, 0)}
             );
         out.push_back(d_op);
 
@@ -277,3 +268,12 @@ out_t split_mem(const std::shared_ptr<libflo::operation<narrow_node>> op,
     }
     return out;
 }
+
+std::shared_ptr<shallow_node> shallow_of(const expand_context& ctx,
+                                         const std::shared_ptr<narrow_node>& n)
+{
+    if (n->snode_count(ctx) == 1)
+        return n->snode(ctx, 0);
+
+    return shallow_node::clone_from(n);
+}
@@ -22,14 +22,22 @@
 #ifndef SPLIT_MEM_HXX
 #define SPLIT_MEM_HXX
 
+#include "bank_decoder.h++"
+#include "expand_context.h++"
 #include "narrow_node.h++"
 #include "shallow_node.h++"
 #include "wide_node.h++"
 #include <libflo/operation.h++>
 #include <vector>
 
+/* Splits accesses to memories that are deeper than the context
+ * allows into accesses to each bank of that memory.  RD and WR ports
+ * generate the given parts of their address's shared bank decoder,
+ * see bank_decoder_plan. */
 std::vector< std::shared_ptr< libflo::operation<shallow_node> > >
 split_mem(const std::shared_ptr<libflo::operation<narrow_node>> op,
-          size_t depth);
+          const expand_context& ctx,
+          mem_split_strategy strategy,
+          const decoder_parts& parts);
 
 #endif
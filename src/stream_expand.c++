@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2014 Palmer Dabbelt
+ *   <palmer.dabbelt@eecs.berkeley.edu>
+ *
+ * This file is part of flo-mwe.
+ *
+ * flo-mwe is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * flo-mwe is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with flo-mwe.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "stream_expand.h++"
+#include "expand_op.h++"
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+/* The number of wide operations that are handed around together,
+ * which has to match the optimizer's batches. */
+#define BATCH_SIZE OPTIMIZE_BATCH_SIZE
+
+/* A run of consecutive wide operations, along with the text of their
+ * expansions once those have been produced.  The expansions are
+ * formatted by the same thread that created them, so the shallow
+ * operations are freed where they were allocated and the writer only
+ * has to copy bytes. */
+struct batch {
+    size_t seq;
+    size_t first;
+    std::vector<flo_reader::op_ptr> in;
+    char *text;
+    size_t text_size;
+    optimize_stats stats;
+
+    batch(void)
+        : seq(0), first(0), in(), text(NULL), text_size(0), stats() {}
+    ~batch(void) { free(text); }
+};
+
+void stream_expand(flo_reader& in, FILE *out,
+                   const expand_context& ctx, size_t jobs,
+                   const bank_decoder_plan& decoders,
+                   adder_strategy adder, size_t karatsuba,
+                   bool optimize_ops,
+                   optimize_stats& stats,
+                   profile *prof)
+{
+    if (jobs == 0)
+        jobs = 1;
+
+    /* The reader stops this far ahead of the writer, which is what
+     * bounds the memory use. */
+    const size_t max_in_flight = 4 * jobs + 2;
+
+    std::mutex lock;
+    std::condition_variable changed;
+    std::deque<std::shared_ptr<batch>> pending;
+    std::map<size_t, std::shared_ptr<batch>> expanded;
+    size_t read = 0;
+    size_t written = 0;
+    bool done_reading = false;
+
+    std::thread reader([&](void) -> void
+        {
+            size_t index = 0;
+
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> l(lock);
+                    changed.wait(l, [&](void) -> bool
+                                 { return read - written < max_in_flight; });
+                }
+
+                auto b = std::make_shared<batch>();
+                b->first = index;
+                b->in.reserve(BATCH_SIZE);
+                while (b->in.size() < BATCH_SIZE) {
+                    uint64_t start = (prof != NULL) ? profile::now() : 0;
+                    auto op = in.next();
+                    if (op == NULL)
+                        break;
+                    if (prof != NULL) {
+                        prof->add_time(profile_phase::PARSE, op->op(),
+                                       profile::now() - start);
+                    }
+                    b->in.push_back(op);
+                }
+                index += b->in.size();
+
+                std::unique_lock<std::mutex> l(lock);
+                if (b->in.size() == 0) {
+                    done_reading = true;
+                    changed.notify_all();
+                    return;
+                }
+
+                b->seq = read++;
+                pending.push_back(b);
+                changed.notify_all();
+            }
+        });
+
+    auto expander = [&](void) -> void
+        {
+            while (true) {
+                std::shared_ptr<batch> b;
+                {
+                    std::unique_lock<std::mutex> l(lock);
+                    changed.wait(l, [&](void) -> bool
+                                 { return !pending.empty() || done_reading; });
+                    if (pending.empty())
+                        return;
+
+                    b = pending.front();
+                    pending.pop_front();
+                }
+
+                FILE *text = open_memstream(&b->text, &b->text_size);
+                if (text == NULL) {
+                    perror("open_memstream() failed");
+                    abort();
+                }
+
+                std::vector<std::shared_ptr<libflo::operation<shallow_node>>>
+                    ops;
+                for (size_t i = 0; i < b->in.size(); ++i) {
+                    auto expanded = expand_op(b->in[i], b->first + i,
+                                              ctx, decoders,
+                                              adder, karatsuba, prof);
+                    ops.insert(ops.end(), expanded.begin(), expanded.end());
+                }
+
+                if (optimize_ops)
+                    optimize(ops, b->stats);
+
+                for (const auto& op: ops) {
+                    if (prof == NULL) {
+                        op->writeln(text);
+                        continue;
+                    }
+
+                    uint64_t start = profile::now();
+                    op->writeln(text);
+                    prof->add_time(profile_phase::WRITE, op->op(),
+                                   profile::now() - start);
+                    prof->add_written(op->op());
+                }
+
+                fclose(text);
+                std::vector<flo_reader::op_ptr>().swap(b->in);
+
+                std::unique_lock<std::mutex> l(lock);
+                expanded[b->seq] = b;
+                changed.notify_all();
+            }
+        };
+
+    std::vector<std::thread> expanders;
+    for (size_t i = 0; i < jobs; ++i)
+        expanders.push_back(std::thread(expander));
+
+    /* Batches can finish expanding in any order, but they're always
+     * written out in the order they were read. */
+    while (true) {
+        std::shared_ptr<batch> b;
+        {
+            std::unique_lock<std::mutex> l(lock);
+            changed.wait(l, [&](void) -> bool
+                         {
+                             return expanded.find(written) != expanded.end()
+                                 || (done_reading && written == read);
+                         });
+
+            auto found = expanded.find(written);
+            if (found == expanded.end())
+                break;
+
+            b = found->second;
+            expanded.erase(found);
+        }
+
+        fwrite(b->text, 1, b->text_size, out);
+        stats += b->stats;
+        b.reset();
+
+        std::unique_lock<std::mutex> l(lock);
+        written++;
+        changed.notify_all();
+    }
+
+    reader.join();
+    for (auto& expander: expanders)
+        expander.join();
+}
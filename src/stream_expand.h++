@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2014 Palmer Dabbelt
+ *   <palmer.dabbelt@eecs.berkeley.edu>
+ *
+ * This file is part of flo-mwe.
+ *
+ * flo-mwe is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * flo-mwe is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with flo-mwe.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STREAM_EXPAND_HXX
+#define STREAM_EXPAND_HXX
+
+#include "adder.h++"
+#include "expand_context.h++"
+#include "flo_reader.h++"
+#include "optimize.h++"
+#include "profile.h++"
+#include <stdio.h>
+
+/* Expands every operation that's left in "in" for the machine
+ * described by "ctx" and writes the resulting shallow operations to
+ * "out", in input order.  When "optimize_ops" is set the operations
+ * are optimized one batch of OPTIMIZE_BATCH_SIZE wide operations at a
+ * time, adding to "stats".  Reading, expanding and writing all happen
+ * at the same time (expanding on "jobs" threads), and only a handful
+ * of batches of operations are ever in flight, so memory use doesn't
+ * depend on the size of the design.  Reading, expanding and writing
+ * each operation are all recorded in "prof" unless that's NULL. */
+void stream_expand(flo_reader& in, FILE *out,
+                   const expand_context& ctx, size_t jobs,
+                   const bank_decoder_plan& decoders,
+                   adder_strategy adder, size_t karatsuba,
+                   bool optimize_ops,
+                   optimize_stats& stats,
+                   profile *prof);
+
+#endif
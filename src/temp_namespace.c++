@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2014 Palmer Dabbelt
+ *   <palmer.dabbelt@eecs.berkeley.edu>
+ *
+ * This file is part of flo-mwe.
+ *
+ * flo-mwe is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * flo-mwe is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with flo-mwe.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "temp_namespace.h++"
+#include <string.h>
+
+static const char *prefixes[TEMP_FAMILY_COUNT] = {
+    "MWEwT",
+    "MWEwW",
+    "MWEnT",
+    "MWEnW",
+    "MWEsT",
+    "MWEsW",
+};
+
+static thread_local temp_namespace *current = NULL;
+
+/* Appends the decimal representation of "value" to "s". */
+static void append_number(std::string& s, unsigned long value);
+
+temp_namespace::temp_namespace(size_t id)
+    : _id(id),
+      _anonymous(false),
+      _prev(current)
+{
+    for (size_t i = 0; i < TEMP_FAMILY_COUNT; ++i)
+        _next[i] = 0;
+
+    current = this;
+}
+
+temp_namespace::temp_namespace(void)
+    : _id(0),
+      _anonymous(true),
+      _prev(NULL)
+{
+    for (size_t i = 0; i < TEMP_FAMILY_COUNT; ++i)
+        _next[i] = 0;
+}
+
+temp_namespace::~temp_namespace(void)
+{
+    if (_anonymous == false)
+        current = _prev;
+}
+
+std::string temp_namespace::name(temp_family family)
+{
+    size_t i = (size_t)family;
+
+    /* Every operation creates a lot of temporaries, so these are built
+     * by hand rather than with snprintf(). */
+    std::string name(prefixes[i]);
+    if (_anonymous == false) {
+        append_number(name, _id);
+        name += '_';
+    }
+    append_number(name, _next[i]++);
+
+    return name;
+}
+
+unsigned long temp_namespace::count(temp_family family) const
+{
+    return _next[(size_t)family];
+}
+
+std::string temp_namespace::next(temp_family family)
+{
+    static temp_namespace anonymous;
+
+    if (current == NULL)
+        return anonymous.name(family);
+
+    return current->name(family);
+}
+
+bool temp_namespace::is_temp(const std::string& name)
+{
+    if (strncmp(name.c_str(), "MWE", 3) != 0)
+        return false;
+
+    for (size_t i = 0; i < TEMP_FAMILY_COUNT; ++i)
+        if (strncmp(name.c_str(), prefixes[i], strlen(prefixes[i])) == 0)
+            return true;
+
+    return false;
+}
+
+const char *temp_namespace::prefix(temp_family family)
+{
+    return prefixes[(size_t)family];
+}
+
+void append_number(std::string& s, unsigned long value)
+{
+    char digits[32];
+    size_t count = 0;
+
+    do {
+        digits[count++] = '0' + (value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    while (count > 0)
+        s += digits[--count];
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2014 Palmer Dabbelt
+ *   <palmer.dabbelt@eecs.berkeley.edu>
+ *
+ * This file is part of flo-mwe.
+ *
+ * flo-mwe is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * flo-mwe is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with flo-mwe.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TEMP_NAMESPACE_HXX
+#define TEMP_NAMESPACE_HXX
+
+#include <string>
+
+/* Every sort of temporary node gets its own family of names, each of
+ * which has a different prefix. */
+enum class temp_family {
+    WIDE_TEMPLATE,      /* MWEwT */
+    WIDE_WIDTH,         /* MWEwW */
+    NARROW_TEMPLATE,    /* MWEnT */
+    NARROW_WIDTH,       /* MWEnW */
+    SHALLOW_TEMPLATE,   /* MWEsT */
+    SHALLOW_WIDTH,      /* MWEsW */
+};
+#define TEMP_FAMILY_COUNT 6
+
+/* Names the temporary nodes that get created while expanding an
+ * operation.  Each operation is expanded inside its own namespace,
+ * which means that the names it generates don't depend on which
+ * thread happened to expand it or on what else has been expanded
+ * before it.  Creating a namespace makes it the current one for the
+ * calling thread until it's destroyed. */
+class temp_namespace {
+private:
+    const size_t _id;
+    const bool _anonymous;
+    unsigned long _next[TEMP_FAMILY_COUNT];
+
+    /* The namespace that was current before this one. */
+    temp_namespace *_prev;
+
+public:
+    temp_namespace(size_t id);
+    ~temp_namespace(void);
+
+private:
+    /* The anonymous namespace is used when nothing else is current,
+     * its names don't include any ID. */
+    temp_namespace(void);
+
+public:
+    /* Returns a new name in the given family. */
+    std::string name(temp_family family);
+
+    /* Returns the number of names that have been handed out in the
+     * given family. */
+    unsigned long count(temp_family family) const;
+
+    /* Returns a new name in the given family from the calling
+     * thread's current namespace.  Note that the anonymous namespace
+     * is shared between every thread, so expanding outside of a
+     * namespace isn't safe to do in parallel. */
+    static std::string next(temp_family family);
+
+    /* Returns TRUE if "name" is one that was handed out by a
+     * namespace (of any ID).  Every use of a temporary comes from the
+     * expansion of the same operation that created it. */
+    static bool is_temp(const std::string& name);
+
+    /* Returns the prefix that every name in the given family starts
+     * with. */
+    static const char *prefix(temp_family family);
+};
+
+#endif
@@ -20,21 +20,18 @@
  */
 
 #include "wide_node.h++"
+#include "temp_namespace.h++"
 #include <libflo/sizet_printf.h++>
 
 #ifndef LINE_MAX
 #define LINE_MAX 1024
 #endif
 
-size_t wide_node::_word_length;
-bool wide_node::_word_length_set = false;
-
-size_t wide_node::_mem_depth;
-bool wide_node::_mem_depth_set = false;
-
 /* Maps this node to a list of narrow nodes. */
-static std::vector<std::shared_ptr<narrow_node>>
-map_narrow(const std::string name,
+static void
+map_narrow(const expand_context& ctx,
+           node_arena<narrow_node>& out,
+           const std::string name,
            const libflo::unknown<size_t>& width,
            const libflo::unknown<size_t>& depth,
            bool is_mem,
@@ -42,8 +39,10 @@ map_narrow(const std::string name,
            libflo::unknown<size_t> cycle,
            const libflo::unknown<std::string>& posn);
 
-static std::vector<std::shared_ptr<narrow_node>>
-map_catd(const std::string name,
+static void
+map_catd(const expand_context& ctx,
+         node_arena<narrow_node>& out,
+         const std::string name,
          const libflo::unknown<size_t>& width,
          const libflo::unknown<size_t>& depth,
          bool is_mem,
@@ -59,132 +58,109 @@ wide_node::wide_node(const std::string name,
                      libflo::unknown<size_t> cycle,
                      const libflo::unknown<std::string>& posn)
     : libflo::node(name, width, depth, is_mem, is_const, cycle, posn),
-      _nns(),
-      _nns_valid(false),
-      _cdn(),
-      _cdn_valid(false)
-{
-}
-
-std::vector<std::shared_ptr<narrow_node>> wide_node::nnodes(void)
-{
-    if (_nns_valid == false) {
-        auto to_add = map_narrow(name(),
-                                 width_u(),
-                                 depth_u(),
-                                 is_mem(),
-                                 is_const(),
-                                 dfdepth_u(),
-                                 posn_u()
-            );
-
-        for (auto it = to_add.begin(); it != to_add.end(); ++it)
-            _nns.push_back(*it);
-
-        _nns_valid = true;
-    }
-
-    return _nns;
-}
-
-std::shared_ptr<narrow_node> wide_node::catdnode(size_t i)
+      _mappings(NULL)
 {
-    if (_cdn_valid == false) {
-        auto to_add = map_catd(name(),
-                               width_u(),
-                               depth_u(),
-                               is_mem(),
-                               is_const(),
-                               dfdepth_u(),
-                               posn_u()
-            );
-
-        for (auto it = to_add.begin(); it != to_add.end(); ++it)
-            _cdn.push_back(*it);
-
-        _cdn_valid = true;
-    }
-
-    return _cdn[i];
 }
 
-void wide_node::set_word_length(size_t word_length)
+wide_node::~wide_node(void)
 {
-    if (wide_node::_word_length_set == true) {
-        fprintf(stderr, "Word length set twice!\n");
-        abort();
+    mapping *m = _mappings.load();
+    while (m != NULL) {
+        mapping *next = m->next;
+        delete m;
+        m = next;
     }
-
-    _word_length_set = true;
-    _word_length = word_length;
 }
 
-size_t wide_node::get_word_length(void)
+wide_node::mapping& wide_node::mapping_for(const expand_context& ctx)
 {
-    if (wide_node::_word_length_set == false) {
-        fprintf(stderr, "Word length get before set\n");
-        abort();
-    }
-
-    return _word_length;
-}
+    mapping *head = _mappings.load(std::memory_order_acquire);
+    for (mapping *m = head; m != NULL; m = m->next)
+        if (m->context == ctx.id())
+            return *m;
+
+    /* This is the first time this node has been used in this
+     * context.  Another thread could be building the same mapping
+     * right now, in which case whichever one gets added to the list
+     * first wins and the other is thrown away.  Nothing but the list
+     * can see a mapping before it's been added. */
+    mapping *fresh = new mapping;
+    fresh->context = ctx.id();
+    map_narrow(ctx,
+               fresh->nns,
+               name(),
+               width_u(),
+               depth_u(),
+               is_mem(),
+               is_const(),
+               dfdepth_u(),
+               posn_u()
+        );
+    fresh->next = head;
+
+    while (!_mappings.compare_exchange_weak(fresh->next, fresh,
+                                            std::memory_order_release,
+                                            std::memory_order_acquire)) {
+        for (mapping *m = fresh->next; m != head; m = m->next) {
+            if (m->context == ctx.id()) {
+                delete fresh;
+                return *m;
+            }
+        }
 
-void wide_node::set_mem_depth(size_t word_length)
-{
-    if (wide_node::_mem_depth_set == true) {
-        fprintf(stderr, "Memory depth set twice!\n");
-        abort();
+        head = fresh->next;
     }
 
-    _mem_depth_set = true;
-    _mem_depth = word_length;
+    return *fresh;
 }
 
-size_t wide_node::get_mem_depth(void)
+const std::shared_ptr<narrow_node>&
+wide_node::catdnode(const expand_context& ctx, size_t i)
 {
-    if (wide_node::_mem_depth_set == false) {
-        fprintf(stderr, "Memory depth get before set\n");
-        abort();
-    }
-
-    return _mem_depth;
+    auto& m = mapping_for(ctx);
+    std::call_once(m.cdn_once, [&](void) -> void
+                   {
+                       map_catd(ctx,
+                                m.cdn,
+                                name(),
+                                width_u(),
+                                depth_u(),
+                                is_mem(),
+                                is_const(),
+                                dfdepth_u(),
+                                posn_u()
+                           );
+                   });
+
+    return m.cdn[i];
 }
 
 std::shared_ptr<wide_node>
 wide_node::create_temp(const size_t width)
 {
-    static unsigned long num = 0;
-
-    char name[LINE_MAX];
-    snprintf(name, LINE_MAX, "MWEwW%lu", num++);
-
-    return std::shared_ptr<wide_node>(
-        new wide_node(name,
-                      width,
-                      0,
-                      false,
-                      false,
-                      libflo::unknown<size_t>(),
-                      libflo::unknown<std::string>()
-            ));
+    auto name = temp_namespace::next(temp_family::WIDE_WIDTH);
+
+    return std::make_shared<wide_node>(name,
+                                       width,
+                                       0,
+                                       false,
+                                       false,
+                                       libflo::unknown<size_t>(),
+                                       libflo::unknown<std::string>());
 }
 
 std::shared_ptr<wide_node>
 wide_node::create_temp(const std::shared_ptr<wide_node> t)
 {
-    static unsigned long num = 0;
-
-    char name[LINE_MAX];
-    snprintf(name, LINE_MAX, "MWEwT%lu", num++);
-
-    return std::shared_ptr<wide_node>(new wide_node(name,
-                                                    t->width_u(),
-                                                    t->depth_u(),
-                                                    false,
-                                                    false,
-                                                    t->dfdepth_u(),
-                                                    t->posn_u()
-                                          ));
+    auto name = temp_namespace::next(temp_family::WIDE_TEMPLATE);
+
+    return std::make_shared<wide_node>(name,
+                                       t->width_u(),
+                                       t->depth_u(),
+                                       false,
+                                       false,
+                                       t->dfdepth_u(),
+                                       t->posn_u());
 }
 
 std::shared_ptr<wide_node>
@@ -193,14 +169,13 @@ wide_node::create_const(const std::shared_ptr<wide_node> t, size_t value)
     char name[LINE_MAX];
     snprintf(name, LINE_MAX, SIZET_FORMAT, value);
 
-    return std::shared_ptr<wide_node>(new wide_node(name,
-                                                    t->width_u(),
-                                                    t->depth_u(),
-                                                    false,
-                                                    true,
-                                                    0,
-                                                    t->posn_u()
-                                          ));
+    return std::make_shared<wide_node>(name,
+                                       t->width_u(),
+                                       t->depth_u(),
+                                       false,
+                                       true,
+                                       0,
+                                       t->posn_u());
 }
 
 std::shared_ptr<wide_node>
@@ -209,14 +184,13 @@ wide_node::create_const(size_t width, size_t value)
     char name[LINE_MAX];
     snprintf(name, LINE_MAX, SIZET_FORMAT, value);
 
-    return std::shared_ptr<wide_node>(new wide_node(name,
-                                                    width,
-                                                    0,
-                                                    false,
-                                                    true,
-                                                    libflo::unknown<size_t>(),
-                                                    libflo::unknown<std::string>()
-                                          ));
+    return std::make_shared<wide_node>(name,
+                                       width,
+                                       0,
+                                       false,
+                                       true,
+                                       libflo::unknown<size_t>(),
+                                       libflo::unknown<std::string>());
 }
 
 std::shared_ptr<wide_node>
@@ -225,31 +199,31 @@ wide_node::create_const(size_t value)
     char name[LINE_MAX];
     snprintf(name, LINE_MAX, SIZET_FORMAT, value);
 
-    return std::shared_ptr<wide_node>(new wide_node(name,
-                                                    libflo::unknown<size_t>(),
-                                                    0,
-                                                    false,
-                                                    true,
-                                                    libflo::unknown<size_t>(),
-                                                    libflo::unknown<std::string>()
-                                          ));
+    return std::make_shared<wide_node>(name,
+                                       libflo::unknown<size_t>(),
+                                       0,
+                                       false,
+                                       true,
+                                       libflo::unknown<size_t>(),
+                                       libflo::unknown<std::string>());
 }
 
 std::shared_ptr<wide_node>
 wide_node::clone_from(std::shared_ptr<narrow_node> n)
 {
-    return std::shared_ptr<wide_node>(new wide_node(n->name(),
-                                                    n->width_u(),
-                                                    n->depth_u(),
-                                                    n->is_mem(),
-                                                    n->is_const(),
-                                                    n->dfdepth_u(),
-                                                    n->posn_u()
-                                            ));
+    return std::make_shared<wide_node>(n->name(),
+                                       n->width_u(),
+                                       n->depth_u(),
+                                       n->is_mem(),
+                                       n->is_const(),
+                                       n->dfdepth_u(),
+                                       n->posn_u());
 }
 
-std::vector<std::shared_ptr<narrow_node>>
-map_narrow(const std::string name,
+void
+map_narrow(const expand_context& ctx,
+           node_arena<narrow_node>& out,
+           const std::string name,
            const libflo::unknown<size_t>& width,
            const libflo::unknown<size_t>& depth,
            bool is_mem,
@@ -257,7 +231,6 @@ map_narrow(const std::string name,
            libflo::unknown<size_t> cycle,
            const libflo::unknown<std::string>& posn)
 {
-    std::vector<std::shared_ptr<narrow_node>> out;
     if (width.known() == false) {
         fprintf(stderr, "Can't build narrow nodes without a width!\n");
         fprintf(stderr, "  Node '%s' has unknown width!\n",
@@ -267,8 +240,9 @@ map_narrow(const std::string name,
 
     /* Here's the number of nodes we need to build from this node. */
     const size_t node_count =
-        (width.value() + wide_node::get_word_length() - 1)
-        / wide_node::get_word_length();
+        (width.value() + ctx.word_length() - 1)
+        / ctx.word_length();
+    out.reserve(node_count);
 
     for (size_t i = 0; i < node_count; ++i) {
         char n[LINE_MAX];
@@ -296,19 +270,18 @@ map_narrow(const std::string name,
          * many nodes that are as wide as possible. */
         libflo::unknown<size_t> w = width;
         if (i != (node_count - 1))
-            w = wide_node::get_word_length();
+            w = ctx.word_length();
         else if (i > 0)
-            w = ((width.value() - 1) % wide_node::get_word_length()) + 1;
+            w = ((width.value() - 1) % ctx.word_length()) + 1;
 
-        auto p = new narrow_node(n, w, depth, is_mem, is_const, cycle, posn);
-        out.push_back(std::shared_ptr<narrow_node>(p));
+        out.emplace(n, w, depth, is_mem, is_const, cycle, posn);
     }
-
-    return out;
 }
 
-std::vector<std::shared_ptr<narrow_node>>
-map_catd(const std::string name,
+void
+map_catd(const expand_context& ctx,
+         node_arena<narrow_node>& out,
+         const std::string name,
          const libflo::unknown<size_t>& width,
          const libflo::unknown<size_t>& depth,
          bool is_mem,
@@ -316,12 +289,11 @@ map_catd(const std::string name,
          libflo::unknown<size_t> cycle,
          const libflo::unknown<std::string>& posn)
 {
-    std::vector<std::shared_ptr<narrow_node>> out;
-
     /* Here's the number of nodes we need to build from this node. */
     const size_t node_count =
-        (width.value() + wide_node::get_word_length() - 1)
-        / wide_node::get_word_length();
+        (width.value() + ctx.word_length() - 1)
+        / ctx.word_length();
+    out.reserve(node_count);
 
     for (size_t i = 0; i < node_count; ++i) {
         char n[LINE_MAX];
@@ -349,13 +321,10 @@ map_catd(const std::string name,
          * many nodes that are as wide as possible. */
         libflo::unknown<size_t> w = width;
         if (i != (node_count - 1))
-            w = (i + 1) * wide_node::get_word_length();
+            w = (i + 1) * ctx.word_length();
         else if (i > 0)
             w = width.value();
 
-        auto p = new narrow_node(n, w, depth, is_mem, is_const, cycle, posn, true);
-        out.push_back(std::shared_ptr<narrow_node>(p));
+        out.emplace(n, w, depth, is_mem, is_const, cycle, posn, true);
     }
-
-    return out;
 }
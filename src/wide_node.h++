@@ -24,10 +24,13 @@
 
 class wide_node;
 
+#include "expand_context.h++"
 #include "narrow_node.h++"
+#include "node_arena.h++"
+#include <atomic>
 #include <libflo/node.h++>
 #include <memory>
-#include <vector>
+#include <mutex>
 
 /* Holds a node that may be too wide to fit inside a single operation.
  * This is a different type from a narrow node to ensure that you
@@ -35,23 +38,23 @@ class wide_node;
 class wide_node: public libflo::node {
     friend class libflo::node;
 
-private:
-    static size_t _word_length;
-    static bool _word_length_set;
-
-    static size_t _mem_depth;
-    static bool _mem_depth_set;
-
 private:
     /* Stores the set of narrow words that coorespond to this wide
-     * word. */
-    std::vector<std::shared_ptr<narrow_node>> _nns;
-    bool _nns_valid;
-
-    /* The list of nodes to chain together when doing a debugging
-     * cat. */
-    std::vector<std::shared_ptr<narrow_node>> _cdn;
-    bool _cdn_valid;
+     * word in one context, along with the list of nodes to chain
+     * together when doing a debugging cat. */
+    struct mapping {
+        size_t context;
+        node_arena<narrow_node> nns;
+        node_arena<narrow_node> cdn;
+        std::once_flag cdn_once;
+        mapping *next;
+    };
+
+    /* Mappings are built lazily, but input nodes are shared between
+     * operations (and contexts) that may be expanded in parallel so
+     * the building only happens once per context.  The list only
+     * ever grows, so looking up a mapping never takes a lock. */
+    std::atomic<mapping *> _mappings;
 
 public:
     wide_node(const std::string name,
@@ -61,35 +64,33 @@ public:
               bool is_const,
               libflo::unknown<size_t> cycle,
               const libflo::unknown<std::string>& );
+    ~wide_node(void);
+
+private:
+    /* Returns this node's mapping in the given context, building it
+     * if it doesn't exist yet. */
+    mapping& mapping_for(const expand_context& ctx);
 
 public:
-    /* Returns an iterator that walks through the list of narrow nodes
-     * that would need to be created in order to implement this node
-     * on a narrow machine. */
-    std::vector<std::shared_ptr<narrow_node>> nnodes(void);
+    /* Returns the list of narrow nodes that would need to be created
+     * in order to implement this node on the narrow machine described
+     * by "ctx".  These are only built once per context, after which
+     * they're handed out as a view into their arena so walking them
+     * doesn't copy anything. */
+    node_span<narrow_node> nnodes(const expand_context& ctx)
+        { return mapping_for(ctx).nns.span(); }
 
     /* Returns a single one of the narrow nodes. */
-    std::shared_ptr<narrow_node> nnode(size_t i) { return nnodes()[i]; }
-    size_t nnode_count(void) { return nnodes().size(); }
+    const std::shared_ptr<narrow_node>&
+    nnode(const expand_context& ctx, size_t i)
+        { return mapping_for(ctx).nns[i]; }
+    size_t nnode_count(const expand_context& ctx)
+        { return mapping_for(ctx).nns.size(); }
 
     /* Here's the list of CATD nodes that serve to produce the actual
      * output node. */
-    std::shared_ptr<narrow_node> catdnode(size_t i);
-
-public:
-    /* Sets a global width parameter that refers to all nodes and
-     * determines the word size of the machine that's being generated
-     * for.  Note that this can only be set once during the life of
-     * the program!  There's also an operation to obtain this word
-     * length. */
-    static void set_word_length(size_t word_length);
-    static size_t get_word_length(void);
-
-    /* Sets a global depth paramater that refers to all memories and
-     * determines the maximum memory depth.  This works similarly to
-     * the depth parameter above. */
-    static void set_mem_depth(size_t mem_depth);
-    static size_t get_mem_depth(void);
+    const std::shared_ptr<narrow_node>&
+    catdnode(const expand_context& ctx, size_t i);
 
     /* Creates a automatically named temporary node based on the
      * template of another node.  The idea is that this new node has
@@ -0,0 +1,49 @@
+#include "tempdir.bash"
+#include "chisel-jar.bash"
+
+cat >test.scala <<EOF
+import Chisel._
+
+class test extends Module {
+  val io = new Bundle {
+    val a = UInt(INPUT,  width = 1000)
+    val b = UInt(INPUT,  width = 1000)
+    val s = UInt(OUTPUT, width = 1000)
+    val d = UInt(OUTPUT, width = 1000)
+    val n = UInt(OUTPUT, width = 1000)
+  }
+
+  io.s := io.a + io.b
+  io.d := io.a - io.b
+  io.n := -io.a
+}
+
+class tests(t: test) extends Tester(t) {
+  val mask = (BigInt(1) << 1000) - 1
+
+  for (cycle <- 0 until 100) {
+    /* Runs of all-ones words are what make carries propagate a long
+     * way, so some of the inputs are built out of them. */
+    val a = if (cycle % 4 == 0) mask else BigInt(1000, rnd)
+    val b = if (cycle % 3 == 0) BigInt(cycle) else BigInt(1000, rnd)
+
+    poke(t.io.a, a)
+    poke(t.io.b, b)
+    step(1)
+
+    expect(t.io.s, (a + b) & mask)
+    expect(t.io.d, (a - b) & mask)
+    expect(t.io.n, (-a) & mask)
+  }
+}
+
+object test {
+  def main(args: Array[String]): Unit = {
+    chiselMainTest(args, () => Module(new test())) { t => new tests(t) }
+  }
+}
+EOF
+
+MWE_ARGS="--adder lookahead"
+
+#include "harness.bash"
@@ -0,0 +1,43 @@
+# Finds the longest chain of combinational operations in a Flo file.
+# Operations aren't always written out in order, so this goes over
+# them until no depth changes.
+#   depth <flo file>
+depth() {
+    awk -v q="'" '
+        NF >= 3 {
+            split($3, op, q)
+            n++
+            name[n] = $1
+            count[n] = NF - 3
+            state[n] = (op[1] == "reg" || op[1] == "in")
+            for (i = 4; i <= NF; i++)
+                src[n, i - 3] = $i
+        }
+
+        END {
+            changed = 1
+            while (changed) {
+                changed = 0
+                for (i = 1; i <= n; i++) {
+                    if (state[i])
+                        continue
+
+                    m = 0
+                    for (j = 1; j <= count[i]; j++)
+                        if (d[src[i, j]] > m)
+                            m = d[src[i, j]]
+
+                    if (d[name[i]] != m + 1) {
+                        d[name[i]] = m + 1
+                        changed = 1
+                    }
+                }
+            }
+
+            m = 0
+            for (i = 1; i <= n; i++)
+                if (d[name[i]] > m)
+                    m = d[name[i]]
+            print m
+        }' "$1"
+}
@@ -0,0 +1,156 @@
+# Evaluates a combinational Flo file for one set of input values and
+# prints the value of every node that isn't a temporary, sorted by
+# name.  Inputs are given by their wide names, the word of an input
+# that was split up is picked out of the wide value.  This is done in
+# plain awk, so every value (including the wide inputs) has to fit in
+# 48 bits.
+#   evaluate_flo <flo file> <word length> <input>=<value>...
+evaluate_flo() {
+    file=$1
+    word=$2
+    shift 2
+
+    awk -v word=$word -v inputs="$*" '
+    function pow2(n) { return 2 ^ n }
+    function mask(v, w) {
+        while (v < 0)
+            v += pow2(w)
+        return v - int(v / pow2(w)) * pow2(w)
+    }
+    function bitwise(a, b, kind,    r, p, x, y, z) {
+        r = 0
+        p = 1
+        while (a > 0 || b > 0) {
+            x = a % 2
+            y = b % 2
+            if (kind == "and") z = x && y
+            else if (kind == "or") z = x || y
+            else z = (x != y)
+            r += z * p
+            a = int(a / 2)
+            b = int(b / 2)
+            p *= 2
+        }
+        return r
+    }
+    function known(t) { return t ~ /^[0-9]/ || (t in value) }
+    function val(t,    parts) {
+        if (t ~ /^[0-9]/) {
+            split(t, parts, "'\''")
+            return parts[1] + 0
+        }
+        return value[t]
+    }
+    function wof(t,    parts) {
+        if (t ~ /^[0-9]/) {
+            if (split(t, parts, "'\''") < 2) {
+                print "No width for constant " t > "/dev/stderr"
+                exit 1
+            }
+            return parts[2] + 0
+        }
+        return width[t]
+    }
+    function input(d, w,    base, k) {
+        if (d in given)
+            return mask(given[d], w)
+
+        base = d
+        sub(/\.[0-9]+$/, "", base)
+        k = substr(d, length(base) + 2) + 0
+        if (!(base in given)) {
+            print "No value for input " d > "/dev/stderr"
+            exit 1
+        }
+        return mask(int(given[base] / pow2(k * word)), w)
+    }
+    function evaluate(i,    o, w, a, b, c, r) {
+        o = op[i]
+        w = opw[i]
+        a = val(src[i, 1])
+        b = val(src[i, 2])
+        c = val(src[i, 3])
+
+        if (o == "in") r = input(dst[i], w)
+        else if (o == "add") r = a + b
+        else if (o == "sub") r = a - b
+        else if (o == "mul") r = a * b
+        else if (o == "neg") r = -a
+        else if (o == "not") r = pow2(w) - 1 - mask(a, w)
+        else if (o == "and" || o == "or" || o == "xor") r = bitwise(a, b, o)
+        else if (o == "mov" || o == "out") r = a
+        else if (o == "mux") r = (a % 2) ? b : c
+        else if (o == "eq") r = (a == b)
+        else if (o == "neq") r = (a != b)
+        else if (o == "lt") r = (a < b)
+        else if (o == "gte") r = (a >= b)
+        else if (o == "lsh") r = (b < w) ? a * pow2(b) : 0
+        else if (o == "rsh" || o == "rshd") r = int(a / pow2(b))
+        else if (o == "cat" || o == "catd")
+            r = mask(a, wof(src[i, 1])) * pow2(wof(src[i, 2])) + b
+        else {
+            print "Unsupported operation " o > "/dev/stderr"
+            exit 1
+        }
+
+        value[dst[i]] = mask(r, width[dst[i]])
+    }
+
+    BEGIN {
+        count = split(inputs, pairs, " ")
+        for (i = 1; i <= count; i++) {
+            split(pairs[i], pair, "=")
+            given[pair[1]] = pair[2] + 0
+        }
+    }
+
+    NF >= 3 {
+        split($3, parts, "'\''")
+        n++
+        dst[n] = $1
+        op[n] = parts[1]
+        opw[n] = parts[2] + 0
+        srcs[n] = NF - 3
+        for (i = 4; i <= NF; i++)
+            src[n, i - 3] = $i
+
+        if (op[n] ~ /^(eq|neq|lt|gte)$/)
+            width[$1] = 1
+        else
+            width[$1] = opw[n]
+    }
+
+    END {
+        left = n
+        while (left > 0) {
+            progress = 0
+            for (i = 1; i <= n; i++) {
+                if (done[i])
+                    continue
+
+                ready = 1
+                for (j = 1; j <= srcs[i]; j++)
+                    if (!known(src[i, j]))
+                        ready = 0
+                if (!ready)
+                    continue
+
+                evaluate(i)
+                done[i] = 1
+                left--
+                progress = 1
+            }
+
+            if (!progress) {
+                print "Some nodes never got a value" > "/dev/stderr"
+                exit 1
+            }
+        }
+
+        for (d in value)
+            if (d !~ /^MWE/)
+                printf "%s %.0f\n", d, value[d]
+    }
+    ' $file >$file.unsorted
+    sort $file.unsorted
+}
@@ -41,10 +41,11 @@ then
     mv $TEST.h $TEST-chisel.h
 fi
 
-# Perform the multi-word expansion
+# Perform the multi-word expansion, tests can pass extra arguments to
+# the expander in MWE_ARGS
 cat $TEST.flo
 mv $TEST.flo $TEST-wide.flo
-$PTEST_BINARY --width 32 --depth 1024 \
+$PTEST_BINARY --width 32 --depth 1024 $MWE_ARGS \
     --input $TEST-wide.flo --output $TEST-nocanon.flo
 cat $TEST-nocanon.flo
 
@@ -0,0 +1,18 @@
+#include "tempdir.bash"
+#include "synth.bash"
+
+# Expands the same design with different numbers of threads, the
+# output has to be byte-for-byte identical no matter how many there
+# were.  This doesn't need Chisel.
+
+synth_design 3000 >test.flo
+
+$PTEST_BINARY --width 32 --depth 1024 --jobs 1 \
+    --input test.flo --output jobs-1.flo
+
+for jobs in 2 4
+do
+    $PTEST_BINARY --width 32 --depth 1024 --jobs $jobs \
+        --input test.flo --output jobs-$jobs.flo
+    cmp jobs-1.flo jobs-$jobs.flo
+done
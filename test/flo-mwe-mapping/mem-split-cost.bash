@@ -0,0 +1,51 @@
+#include "tempdir.bash"
+#include "depth.bash"
+
+# Compares a 4096-deep memory that's split into banks selected by a
+# linear chain of MUXes against one where they're selected by a tree.
+# This doesn't need Chisel, it just counts how many operations each
+# one takes and how deep it is.  With more than two banks the tree
+# (whose ports share their bank decoders) has to be shallower than the
+# chain without taking any more operations, and "auto" has to pick it.
+
+cat >test.flo <<EOF
+io_a = in'12
+io_b = in'12
+io_d = in'32
+io_we = in'1
+M = mem'32 4096
+T0 = rd'32 io_we M io_a
+T1 = rd'32 io_we M io_b
+T2 = rd'32 io_we M io_a
+T3 = wr'32 io_we M io_b io_d
+T4 = add'32 T0 T1
+T5 = xor'32 T4 T2
+io_o = out'32 T5
+EOF
+
+printf "%5s %-8s %5s %6s\n" banks strategy ops depth
+for mem_depth in 1024 256 64
+do
+    for strategy in linear tree auto
+    do
+        $PTEST_BINARY --width 32 --depth $mem_depth \
+            --mem-split-strategy $strategy \
+            --input test.flo --output $strategy-$mem_depth.flo
+
+        ops=$(grep -vc " = mem'" $strategy-$mem_depth.flo)
+        deep=$(depth $strategy-$mem_depth.flo)
+        printf "%5d %-8s %5d %6d\n" $((4096 / mem_depth)) $strategy \
+            $ops $deep
+
+        eval "${strategy}_ops=$ops"
+        eval "${strategy}_depth=$deep"
+    done
+
+    if [[ $tree_depth -ge $linear_depth || $tree_ops -gt $linear_ops ]]
+    then
+        echo "The tree wasn't better than the chain for $mem_depth-deep banks"
+        exit 1
+    fi
+
+    cmp tree-$mem_depth.flo auto-$mem_depth.flo
+done
@@ -0,0 +1,69 @@
+#include "tempdir.bash"
+#include "depth.bash"
+
+# Compares multipliers that are expanded with the default --karatsuba
+# threshold against ones that are multiplied limb-by-limb and ones
+# that are split with Karatsuba's algorithm all the way down.  This
+# doesn't need Chisel, it just counts how many operations each one
+# takes and how deep it is.  The default has to be no bigger and no
+# deeper than either of the others, and has to be strictly smaller
+# than limb-by-limb at 576 bits (18 words), where Karatsuba starts to
+# win.  Karatsuba all the way down has to have saved some narrow
+# multiplications by the time it's split a 512-bit multiply.
+
+printf "%5s %-10s %6s %5s %6s\n" bits multiply ops muls depth
+for bits in 64 128 256 512 576 1024
+do
+    cat >mul-$bits.flo <<EOF
+io_a = in'$bits
+io_b = in'$bits
+P = mul'$((bits * 2)) io_a io_b
+io_p = out'$((bits * 2)) P
+EOF
+
+    for mode in default schoolbook karatsuba
+    do
+        threshold=""
+        if [[ "$mode" == "schoolbook" ]]
+        then
+            threshold="--karatsuba 1000000"
+        elif [[ "$mode" == "karatsuba" ]]
+        then
+            threshold="--karatsuba 1"
+        fi
+
+        $PTEST_BINARY --width 32 --depth 1024 $threshold \
+            --input mul-$bits.flo --output $mode-$bits.flo
+
+        ops=$(cat $mode-$bits.flo | wc -l)
+        muls=$(grep -c " mul'" $mode-$bits.flo)
+        deep=$(depth $mode-$bits.flo)
+        printf "%5d %-10s %6d %5d %6d\n" $bits $mode $ops $muls $deep
+
+        if [[ "$mode" == "default" ]]
+        then
+            default_ops=$ops
+            default_depth=$deep
+        elif [[ $ops -lt $default_ops || $deep -lt $default_depth ]]
+        then
+            echo "$mode beat the default at $bits bits"
+            exit 1
+        fi
+    done
+done
+
+default=$(cat default-576.flo | wc -l)
+schoolbook=$(cat schoolbook-576.flo | wc -l)
+if [[ $default -ge $schoolbook ]]
+then
+    echo "The default used $default operations, schoolbook $schoolbook"
+    exit 1
+fi
+
+schoolbook=$(grep -c " mul'" schoolbook-512.flo)
+karatsuba=$(grep -c " mul'" karatsuba-512.flo)
+if [[ $karatsuba -ge $schoolbook ]]
+then
+    echo "Karatsuba used $karatsuba multiplies, schoolbook $schoolbook"
+    exit 1
+fi
@@ -0,0 +1,63 @@
+#include "tempdir.bash"
+#include "evaluate.bash"
+
+# Expands a design with and without the optimizer, and checks that
+# every node that isn't a temporary ends up with the same value either
+# way, that --stats reports something was removed, and that the
+# optimized output is no longer than the plain one.  The words are 16
+# bits wide so that awk can evaluate the expanded designs, and the
+# evaluator insists on knowing the width of every CAT source (which a
+# bare constant doesn't have).  This doesn't need Chisel.
+
+cat >test.flo <<EOF
+io_a = in'48
+io_b = in'48
+io_s = in'4
+io_e = in'1
+T0 = add'48 io_a io_b
+T1 = sub'48 T0 io_b
+T2 = xor'48 T1 io_a
+T3 = and'48 T2 io_b
+T4 = or'48 T3 io_a
+T5 = not'48 T4
+T6 = lsh'48 T5 io_s
+T7 = rsh'48 T6 io_s
+T8 = rsh'48 T7 16
+T9 = lsh'48 T8 16
+T10 = mux'48 io_e T9 io_b
+T11 = lt'48 T10 io_a
+T12 = eq'48 T10 io_a
+T13 = cat'48 T11 T10
+T14 = mul'48 io_a io_b
+T15 = add'48 T14 T13
+T16 = add'48 T15 12345
+T17 = neg'48 T16
+T18 = rsh'48 T17 3
+T19 = rsh'48 T15 21
+io_o = out'48 T17
+io_p = out'1 T12
+io_q = out'48 T18
+io_r = out'48 T19
+EOF
+
+$PTEST_BINARY --width 16 --depth 1024 --no-optimize --stats \
+    --input test.flo --output plain.flo 2>plain.stats
+$PTEST_BINARY --width 16 --depth 1024 --stats \
+    --input test.flo --output optimized.flo 2>optimized.stats
+
+grep -q '^  total: *0$' plain.stats
+grep -q '^  total: *[1-9]' optimized.stats
+[[ $(cat optimized.flo | wc -l) -le $(cat plain.flo | wc -l) ]]
+
+for inputs in \
+    "io_a=0 io_b=0 io_s=0 io_e=0" \
+    "io_a=281474976710655 io_b=281474976710655 io_s=15 io_e=1" \
+    "io_a=20015998343868 io_b=280223976814164 io_s=5 io_e=1" \
+    "io_a=280223976814164 io_b=65535 io_s=9 io_e=0" \
+    "io_a=65536 io_b=65535 io_s=0 io_e=1"
+do
+    evaluate_flo plain.flo 16 $inputs >plain.values
+    evaluate_flo optimized.flo 16 $inputs >optimized.values
+    cat optimized.values
+    cmp plain.values optimized.values
+done
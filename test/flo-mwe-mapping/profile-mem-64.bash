@@ -0,0 +1,58 @@
+#include "tempdir.bash"
+
+# Expands a memory that's wider than a word, along with an adder that
+# reads from it, with --profile turned on.  This doesn't need Chisel,
+# it just checks that the JSON that comes out accounts for every
+# operation, both when streaming and when not, and that every target
+# gets a profile of its own.
+
+cat >test.flo <<EOF
+io_a = in'12
+io_d = in'64
+io_we = in'1
+M = mem'64 4096
+T0 = rd'64 io_we M io_a
+T1 = wr'64 io_we M io_a io_d
+T2 = add'64 T0 io_d
+io_o = out'64 T2
+EOF
+
+for mode in "" --stream
+do
+    $PTEST_BINARY --width 32 --depth 1024 $mode \
+        --input test.flo --output out.flo --profile profile.json
+    cat profile.json
+
+    grep -q '"add": {"wide_in": 1,' profile.json
+    grep -q '"rd": {"wide_in": 1,' profile.json
+    grep -q '"wr": {"wide_in": 1,' profile.json
+    grep -q '"peak_rss_kb": [1-9]' profile.json
+
+    written=$(grep -o '"written": [0-9]*' profile.json \
+              | awk '{ sum += $2 } END { print sum }')
+    [[ "$written" == "$(grep -vc " = mem'" out.flo)" ]]
+done
+
+$PTEST_BINARY --target 32:1024 --target 64:4096 --jobs 2 \
+    --input test.flo --output out-%w-%d.flo --profile profile-%w-%d.json
+
+for target in 32:1024 64:4096
+do
+    width=${target%:*}
+    depth=${target#*:}
+    cat profile-$width-$depth.json
+
+    grep -q "\"width\": $width," profile-$width-$depth.json
+    grep -q "\"depth\": $depth," profile-$width-$depth.json
+
+    written=$(grep -o '"written": [0-9]*' profile-$width-$depth.json \
+              | awk '{ sum += $2 } END { print sum }')
+    [[ "$written" == "$(grep -vc " = mem'" out-$width-$depth.flo)" ]]
+done
+
+if $PTEST_BINARY --target 32:1024 --target 64:4096 \
+    --input test.flo --output out-%w-%d.flo --profile profile.json
+then
+    echo "Two targets were allowed to write the same profile"
+    exit 1
+fi
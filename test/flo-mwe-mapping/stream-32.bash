@@ -0,0 +1,22 @@
+#include "tempdir.bash"
+#include "synth.bash"
+
+# Expands the same design with and without --stream, the output has
+# to be byte-for-byte identical either way (with or without the
+# optimizer, and no matter how many threads are streaming).  This
+# doesn't need Chisel.
+
+synth_design 3000 >test.flo
+
+for args in "" --no-optimize
+do
+    $PTEST_BINARY --width 32 --depth 1024 $args \
+        --input test.flo --output whole.flo
+
+    for jobs in 1 3
+    do
+        $PTEST_BINARY --width 32 --depth 1024 $args --stream --jobs $jobs \
+            --input test.flo --output stream.flo
+        cmp whole.flo stream.flo
+    done
+done
@@ -0,0 +1,36 @@
+# Writes a wide Flo design to stdout that doesn't need Chisel.  It
+# uses most of the operations the expander knows about, and is big
+# enough to span several batches when streaming.
+#   synth_design <operation count>
+synth_design() {
+    echo "io_a = in'192"
+    echo "io_b = in'192"
+    echo "io_s = in'8"
+    echo "io_e = in'1"
+    echo "io_x = in'12"
+    echo "M = mem'96 4096"
+
+    prev=io_a
+    for i in $(seq 1 $1)
+    do
+        case $((i % 10)) in
+        0) echo "T$i = add'192 $prev io_b";;
+        1) echo "T$i = sub'192 io_b $prev";;
+        2) echo "T$i = xor'192 $prev io_a";;
+        3) echo "T$i = lsh'192 $prev io_s";;
+        4) echo "T$i = rsh'192 $prev $((i % 190))";;
+        5) echo "T$i = mux'192 io_e $prev io_a";;
+        6) echo "T$i = and'192 $prev io_b";;
+        7) echo "R$i = rd'96 io_e M io_x"
+           echo "T$i = cat'192 R$i R$i";;
+        8) echo "L$i = lt'192 $prev io_b"
+           echo "T$i = mux'192 L$i $prev io_b";;
+        9) echo "C$i = rsh'96 $prev 50"
+           echo "W$i = wr'96 io_e M io_x C$i"
+           echo "T$i = reg'192 1 $prev";;
+        esac
+        prev=T$i
+    done
+
+    echo "io_o = out'192 $prev"
+}
@@ -0,0 +1,33 @@
+#include "tempdir.bash"
+
+# Expands the same design for three different targets in a single
+# run, and checks that every output is exactly what a separate run for
+# just that target produces.  This doesn't need Chisel.
+
+cat >test.flo <<EOF
+io_a = in'12
+io_b = in'96
+io_d = in'64
+io_we = in'1
+M = mem'64 4096
+T0 = rd'64 io_we M io_a
+T1 = wr'64 io_we M io_a io_d
+T2 = add'64 T0 io_d
+T3 = mul'96 io_b io_b
+T4 = rsh'96 T3 io_a
+io_o = out'64 T2
+io_p = out'96 T4
+EOF
+
+$PTEST_BINARY --target 32:1024 --target 64:4096 --target 16:256 \
+    --jobs 3 --input test.flo --output out-%w-%d.flo
+
+for target in 32:1024 64:4096 16:256
+do
+    width=${target%:*}
+    depth=${target#*:}
+
+    $PTEST_BINARY --width $width --depth $depth \
+        --input test.flo --output single.flo
+    cmp single.flo out-$width-$depth.flo
+done
@@ -0,0 +1,39 @@
+#include "tempdir.bash"
+#include "chisel-jar.bash"
+
+cat >test.scala <<EOF
+import Chisel._
+
+class test extends Module {
+  val io = new Bundle {
+    val i = UInt(INPUT,  width = 200)
+    val s = UInt(INPUT,  width = 8)
+    val l = UInt(OUTPUT, width = 455)
+    val r = UInt(OUTPUT, width = 200)
+  }
+
+  io.l := io.i << io.s
+  io.r := io.i >> io.s
+}
+
+class tests(t: test) extends Tester(t) {
+  for (cycle <- 0 until 256) {
+    val i = BigInt(200, rnd)
+
+    poke(t.io.i, i)
+    poke(t.io.s, cycle)
+    step(1)
+
+    expect(t.io.l, i << cycle)
+    expect(t.io.r, i >> cycle)
+  }
+}
+
+object test {
+  def main(args: Array[String]): Unit = {
+    chiselMainTest(args, () => Module(new test())) { t => new tests(t) }
+  }
+}
+EOF
+
+#include "harness.bash"